@@ -55,6 +55,60 @@
 #define DUNGEON_MAX_NUM_ITEMS 25
 #endif
 
+#ifndef DUNGEON_USE_MST_CORRIDORS
+#define DUNGEON_USE_MST_CORRIDORS 0
+#endif
+
+#ifndef DUNGEON_PATHING_BUCKET_MAX_WEIGHT
+#define DUNGEON_PATHING_BUCKET_MAX_WEIGHT 16
+#endif
+
+#ifndef DUNGEON_USE_BITWISE_BFS
+#define DUNGEON_USE_BITWISE_BFS 1
+#endif
+
+#ifndef DUNGEON_USE_FLOW_FIELDS
+#define DUNGEON_USE_FLOW_FIELDS 1
+#endif
+
+#ifndef DUNGEON_TARGET_FIELD_CACHE_SIZE
+#define DUNGEON_TARGET_FIELD_CACHE_SIZE 8
+#endif
+
+#ifndef DUNGEON_REGION_PATHING_MIN_CELLS
+#define DUNGEON_REGION_PATHING_MIN_CELLS 16384
+#endif
+
+#ifndef DUNGEON_PREGENERATE_LEVELS
+#define DUNGEON_PREGENERATE_LEVELS 1
+#endif
+
+#ifndef DUNGEON_LEVEL_CACHE_MAX_BYTES
+#define DUNGEON_LEVEL_CACHE_MAX_BYTES (256 << 20)
+#endif
+
+#ifndef DUNGEON_PARALLEL_NPC_TURNS
+#define DUNGEON_PARALLEL_NPC_TURNS 1
+#endif
+#ifndef DUNGEON_PARALLEL_NPC_MIN_BATCH
+#define DUNGEON_PARALLEL_NPC_MIN_BATCH 64
+#endif
+
+#ifndef DUNGEON_TURN_WHEEL_BITS
+#define DUNGEON_TURN_WHEEL_BITS 10
+#endif
+
+#ifndef DUNGEON_FOV_RADIUS
+#define DUNGEON_FOV_RADIUS 0
+#endif
+#ifndef DUNGEON_PC_LIGHT_RADIUS
+#define DUNGEON_PC_LIGHT_RADIUS 2
+#endif
+
+#ifndef DUNGEON_MAP_SCROLL_MARGIN
+#define DUNGEON_MAP_SCROLL_MARGIN 4
+#endif
+
 #ifndef DUNGEON_FILE_NAME
 #define DUNGEON_FILE_NAME "dungeon"
 #endif
@@ -70,20 +124,18 @@
 
 
 
-#define DUNGEON_TOTAL_CELLS     (DUNGEON_X_DIM * DUNGEON_Y_DIM)
-
-#define DUNGEON_MAP_WIN_X_DIM   DUNGEON_X_DIM
-#define DUNGEON_MAP_WIN_Y_DIM   DUNGEON_Y_DIM
+#define DUNGEON_MAP_WIN_X_DIM   80
+#define DUNGEON_MAP_WIN_Y_DIM   21
 #define DUNGEON_MAP_WIN_X_OFF   0
 #define DUNGEON_MAP_WIN_Y_OFF   1
 
-#define MONLIST_WIN_X_DIM       (DUNGEON_X_DIM - 2)
-#define MONLIST_WIN_Y_DIM       (DUNGEON_Y_DIM - 2)
+#define MONLIST_WIN_X_DIM       (DUNGEON_MAP_WIN_X_DIM - 2)
+#define MONLIST_WIN_Y_DIM       (DUNGEON_MAP_WIN_Y_DIM - 2)
 #define MONLIST_WIN_X_OFF       (DUNGEON_MAP_WIN_X_OFF + 1)
 #define MONLIST_WIN_Y_OFF       (DUNGEON_MAP_WIN_Y_OFF + 1)
 
-#define INVENTORY_WIN_X_DIM       (DUNGEON_X_DIM - 2)
-#define INVENTORY_WIN_Y_DIM       (DUNGEON_Y_DIM - 2)
+#define INVENTORY_WIN_X_DIM       (DUNGEON_MAP_WIN_X_DIM - 2)
+#define INVENTORY_WIN_Y_DIM       (DUNGEON_MAP_WIN_Y_DIM - 2)
 #define INVENTORY_WIN_X_OFF       (DUNGEON_MAP_WIN_X_OFF + 1)
 #define INVENTORY_WIN_Y_OFF       (DUNGEON_MAP_WIN_Y_OFF + 1)
 
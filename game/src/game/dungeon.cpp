@@ -1,27 +1,49 @@
 #include "dungeon.hpp"
 
+#include <cassert>
 #include <cstring>
 #include <random>
 
 #include <endian.h>
 
 #include "util/perlin.hpp"
+#include "util/shadowcast.hpp"
+
+#ifndef INCREMENTAL_COSTS_DEBUG
+#define INCREMENTAL_COSTS_DEBUG 0
+#endif
+
+// the RLG327 save format always stores an 80x21 grid with 8-bit coordinates
+static constexpr uint16_t
+    RLG327_X_DIM = 80,
+    RLG327_Y_DIM = 21;
+
+
+// bounds placement time when rooms no longer fit
+static constexpr size_t ROOM_PLACEMENT_MAX_ATTEMPTS = 100000;
 
 
 static int terrain_map_connect_rooms(DungeonLevel::TerrainMap& map, std::mt19937& gen)
 {
+#if DUNGEON_USE_MST_CORRIDORS
+    (void)gen;
+    return dungeon_dijkstra_corridor_tree(PathingContext::local(), map);
+#else
+    // ring -- each room to the next, between random cells of both
     for(size_t i = 0; i < map.rooms.size(); i++)
     {
         const size_t i2 = (i + 1) % map.rooms.size();
-        Vec2u8
-            pos_r1 = Vec2u8::randomInRange(map.rooms[i].tl, map.rooms[i].br, gen),
-            pos_r2 = Vec2u8::randomInRange(map.rooms[i2].tl, map.rooms[i2].br, gen);
+        Vec2u16
+            pos_r1 = Vec2u16::randomInRange(map.rooms[i].tl, map.rooms[i].br, gen),
+            pos_r2 = Vec2u16::randomInRange(map.rooms[i2].tl, map.rooms[i2].br, gen);
 
-        dungeon_dijkstra_corridor_path(map, pos_r1, pos_r2);
+        dungeon_dijkstra_corridor_path(PathingContext::local(), map, pos_r1, pos_r2);
     }
 
     return 0;
+#endif
 }
+
 static int terrain_map_fill_room_cells(DungeonLevel::TerrainMap& map)
 {
     for(size_t r = 0; r < map.rooms.size(); r++)
@@ -48,12 +70,12 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
     map.rooms.clear();
     map.rooms.resize(target);
 
-    static const Vec2u8
+    const Vec2u16
         d_min{ 1, 1 },
         d_max
         {
-            (DUNGEON_X_DIM - DUNGEON_ROOM_MIN_X - 1),
-            (DUNGEON_Y_DIM - DUNGEON_ROOM_MIN_Y - 1)
+            static_cast<uint16_t>(map.width() - DUNGEON_ROOM_MIN_X - 1),
+            static_cast<uint16_t>(map.height() - DUNGEON_ROOM_MIN_Y - 1)
         },
         s_min
         {
@@ -61,49 +83,44 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
             (DUNGEON_ROOM_MIN_Y - 1)
         };
 
+    // cells of every placed room -- a room collides with another exactly when its rect grown by one is occupied
+    BitRows occupied{ map.width(), map.height() };
+    auto is_open = [&occupied](const DungeonLevel::TerrainMap::Room& r)
+    {
+        return !occupied.anyInRect(r.tl.y - 1, r.br.y + 1, r.tl.x - 1, r.br.x + 1);
+    };
+    auto occupy = [&occupied](const DungeonLevel::TerrainMap::Room& r, bool v)
+    {
+        for(size_t y = r.tl.y; y <= r.br.y; y++) occupied.assignRange(y, r.tl.x, r.br.x, v);
+    };
+
 // 1. GENERATE AT LEAST THE MINIMUM NUMBER OF ROOMS
-    size_t iter = 0;
-    for(size_t i = 0; i < DUNGEON_MIN_NUM_ROOMS; iter++)
+    size_t rnum = 0;
+    for(size_t iter = 0; rnum < DUNGEON_MIN_NUM_ROOMS && iter < ROOM_PLACEMENT_MAX_ATTEMPTS; iter++)
     {
-        DungeonLevel::TerrainMap::Room& r = map.rooms[i];
-        r.tl = Vec2u8::randomInRange(d_min, d_max, gen);
+        DungeonLevel::TerrainMap::Room& r = map.rooms[rnum];
+        r.tl = Vec2u16::randomInRange(d_min, d_max, gen);
         r.br = r.tl + s_min;
 
-        if(i == 0)
+        if(is_open(r))
         {
-            i++;
-            continue;
+            occupy(r, true);
+            rnum++;
         }
-
-        int failed = 0;
-        for(size_t j = 0; j < i; j++)
-        {
-            if(r.collides(map.rooms[j]))
-            {
-                failed = 1;
-                break;
-            }
-        }
-        if(!failed) i++;
     }
     // PRINT_DEBUG("Took %lu iterations to generate core rooms.\n", iter)
 
 // 2. GENERATE EXTRA ROOMS
-    size_t rnum = DUNGEON_MIN_NUM_ROOMS;
     for(size_t i = DUNGEON_MIN_NUM_ROOMS; i < target; i++)
     {
         DungeonLevel::TerrainMap::Room& r = map.rooms[rnum];
-        r.tl = Vec2u8::randomInRange(d_min, d_max, gen);
+        r.tl = Vec2u16::randomInRange(d_min, d_max, gen);
         r.br = r.tl + s_min;
 
-        rnum++;
-        for(size_t j = 0; j < rnum; j++)
+        if(is_open(r))
         {
-            if(r.collides(map.rooms[j]))
-            {
-                rnum--;
-                break;
-            }
+            occupy(r, true);
+            rnum++;
         }
     }
     // PRINT_DEBUG("Total dungeons generated: %lu\n", R)
@@ -114,7 +131,7 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
     // d->num_rooms = R;
 
 // 3. EXPAND DIMENSIONS
-    static const Vec2u8
+    static const Vec2u16
         r_min{ DUNGEON_ROOM_MIN_X, DUNGEON_ROOM_MIN_Y },
         r_max{ DUNGEON_ROOM_MAX_X, DUNGEON_ROOM_MAX_Y };
 
@@ -122,37 +139,33 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
     {
         DungeonLevel::TerrainMap::Room& room = map.rooms[r];
 
-        Vec2u8 target_size = Vec2u8::randomInRange(r_min, r_max, gen);
+        Vec2u16 target_size = Vec2u16::randomInRange(r_min, r_max, gen);
         // vec2u_random_in_range(&target_size, r_min, r_max);
 
         int status = 0;
 
-        Vec2u8 size = room.size();
+        Vec2u16 size = room.size();
         // dungeon_room_size(dr, &size);
         size_t iter = 0;
+        occupy(room, false);    // only the other rooms count while growing
         for(uint8_t b = 0; status < 0b1111 && size.x < target_size.x && size.y < target_size.y; b = !b)
         {
         #define CHECK_COLLISIONS(K, reset) \
-            for(size_t i = 1; i < rnum; i++) \
+            if(!is_open(room)) \
             {   \
-                size_t rr = (r + i) % rnum; \
-                if(room.collides(map.rooms[rr])) \
-                {   \
-                    status |= (K); \
-                    reset; \
-                    break; \
-                } \
+                status |= (K); \
+                reset; \
             }
 
             if((b && status < 0b11) || (status & 0b1100))
             {
-                if(room.br.x >= (DUNGEON_X_DIM - 2)) status |= 0b0001;
+                if(room.br.x >= (map.width() - 2)) status |= 0b0001;
                 if(!(status & 0b0001))
                 {
                     room.br.x += 1;
                     CHECK_COLLISIONS(0b0001, room.br.x -= 1)
                 }
-                if(room.br.y >= (DUNGEON_Y_DIM - 2)) status |= 0b0010;
+                if(room.br.y >= (map.height() - 2)) status |= 0b0010;
                 if(!(status & 0b0010))
                 {
                     room.br.y += 1;
@@ -182,6 +195,7 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
 
         #undef CHECK_COLLISIONS
         }
+        occupy(room, true);
     }
 
     terrain_map_connect_rooms(map, gen);
@@ -191,9 +205,9 @@ static int terrain_map_generate_floors(DungeonLevel::TerrainMap& map, std::mt199
 
 static int terrain_map_place_stairs(DungeonLevel::TerrainMap& map, std::mt19937& gen)
 {
-    static const Vec2u8
+    const Vec2u16
         d_min{ 1, 1 },
-        d_max{ (DUNGEON_X_DIM - 2), (DUNGEON_Y_DIM - 2) };
+        d_max{ static_cast<uint16_t>(map.width() - 2), static_cast<uint16_t>(map.height() - 2) };
 
     std::uniform_int_distribution<uint16_t>
         nstair_dist{ DUNGEON_MIN_NUM_EACH_STAIR, DUNGEON_MAX_NUM_EACH_STAIR };
@@ -201,10 +215,10 @@ static int terrain_map_place_stairs(DungeonLevel::TerrainMap& map, std::mt19937&
     map.num_up_stair = nstair_dist(gen);
     map.num_down_stair = nstair_dist(gen);
 
-    Vec2u8 p;
+    Vec2u16 p;
     for(uint16_t i = 0; i < map.num_up_stair;)
     {
-        p = Vec2u8::randomInRange(d_min, d_max, gen);
+        p = Vec2u16::randomInRange(d_min, d_max, gen);
         DungeonLevel::TerrainMap::Cell& c = map.terrain[p.y][p.x];
         if(c.type > 0)
         {
@@ -214,7 +228,7 @@ static int terrain_map_place_stairs(DungeonLevel::TerrainMap& map, std::mt19937&
     }
     for(uint16_t i = 0; i < map.num_down_stair;)
     {
-        p = Vec2u8::randomInRange(d_min, d_max, gen);
+        p = Vec2u16::randomInRange(d_min, d_max, gen);
         DungeonLevel::TerrainMap::Cell& c = map.terrain[p.y][p.x];
         if(c.type > 0)
         {
@@ -267,42 +281,77 @@ bool DungeonLevel::TerrainMap::Room::collides(const Room& other) const
 }
 
 
+void DungeonLevel::TerrainMap::resize(uint16_t w, uint16_t h)
+{
+    this->terrain.resize(w, h);
+    this->reset();
+}
+
 void DungeonLevel::TerrainMap::reset()
 {
-    for(size_t i = 0; i < DUNGEON_Y_DIM; i++)
+    const size_t w = this->width(), h = this->height();
+
+    this->terrain.fill(Cell{});
+    for(size_t i = 0; i < h; i++)
     {
-        memset(this->terrain[i], 0x0, sizeof(this->terrain[i]));
-        this->hardness[i][0] = this->hardness[i][DUNGEON_X_DIM - 1] = 0xFF;
+        this->terrain[i][0].hardness = this->terrain[i][w - 1].hardness = 0xFF;
     }
-    for(size_t i = 1; i < DUNGEON_X_DIM - 1; i++)
+    for(size_t i = 1; i < w - 1; i++)
     {
-        this->hardness[0][i] = this->hardness[DUNGEON_Y_DIM - 1][i] = 0xFF;
+        this->terrain[0][i].hardness = this->terrain[h - 1][i].hardness = 0xFF;
     }
 
     this->rooms.clear();
     this->num_up_stair = this->num_down_stair = 0;
+    this->rebuildMasks();
+    this->version++;
 }
 
 void DungeonLevel::TerrainMap::generate(uint32_t seed)
 {
     std::mt19937 rgen{ seed };
 
+    this->version++;
+
     const int r = rgen();
     const float
         rx = (float)(r & 0xFF),
         ry = (float)((r >> 8) & 0xFF);
 
-    for(size_t y = 1; y < DUNGEON_Y_DIM - 1; y++)
+    // same samples as perlin2f((float)x * DUNGEON_PERLIN_SCALE_X + rx, (float)y * DUNGEON_PERLIN_SCALE_Y + ry)
+    std::vector<float> noise(this->width() - 2u);
+    for(size_t y = 1; y < this->height() - 1u; y++)
     {
-        for(size_t x = 1; x < DUNGEON_X_DIM - 1; x++)
+        perlin2f_row(noise.data(), noise.size(), 1, DUNGEON_PERLIN_SCALE_X, rx, (float)y * DUNGEON_PERLIN_SCALE_Y + ry);
+        for(size_t x = 1; x < this->width() - 1u; x++)
         {
-            const float p = perlin2f((float)x * DUNGEON_PERLIN_SCALE_X + rx, (float)y * DUNGEON_PERLIN_SCALE_Y + ry);
-            this->hardness[y][x] = (uint8_t)(p * 127.f + 127.f);
+            this->terrain[y][x].hardness = (uint8_t)(noise[x - 1] * 127.f + 127.f);
         }
     }
 
     terrain_map_generate_floors(*this, rgen);
     terrain_map_place_stairs(*this, rgen);
+
+    this->rebuildMasks();
+}
+
+void DungeonLevel::TerrainMap::rebuildMasks()
+{
+    const size_t w = this->width(), h = this->height();
+
+    this->floor_mask.resize(w, h);
+    this->stair_mask.resize(w, h);
+    this->solid_mask.resize(w, h);
+    for(size_t y = 0; y < h; y++)
+    {
+        for(size_t x = 0; x < w; x++)
+        {
+            const Cell c = this->terrain[y][x];
+            if(c.isFloor()) this->floor_mask.set(y, x);
+            else if(c.hardness == 0xFF) this->solid_mask.set(y, x);
+            if(c.isStair()) this->stair_mask.set(y, x);
+        }
+    }
 }
 
 
@@ -322,24 +371,44 @@ DungeonLevel::~DungeonLevel()
     }
 }
 
+// all level state is discarded, including items
+void DungeonLevel::resize(uint16_t w, uint16_t h)
+{
+    this->deleteItems();
+
+    this->map.resize(w, h);
+    this->tunnel_costs.resize(w, h);
+    this->terrain_costs.resize(w, h);
+    this->tunnel_dirs.resize(w, h);
+    this->terrain_dirs.resize(w, h);
+    this->visibility_map.resize(w, h);
+    this->pc_fov.resize(w, h);
+    this->entity_map.resize(w, h);
+    this->item_map.resize(w, h);
+    this->occupied.resize(w, h);
+
+    this->reset();
+}
+
 void DungeonLevel::reset()
 {
     this->map.reset();
     this->deleteItems();
 
-    memset(this->visibility_map, ' ', sizeof(uint8_t) * DUNGEON_TOTAL_CELLS);
-    memset(this->entity_map, 0x0, sizeof(Entity*) * DUNGEON_TOTAL_CELLS);
-    memset(this->item_map, 0x0, sizeof(uint32_t) * DUNGEON_TOTAL_CELLS);
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
-    {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            this->tunnel_costs[y][x] = std::numeric_limits<int32_t>::max();
-            this->terrain_costs[y][x] = std::numeric_limits<int32_t>::max();
-        }
-    }
-
-    this->entity_queue = std::priority_queue<EntityQueueNode>{};
+    this->visibility_map.fill(' ');
+    this->pc_fov.clear();
+    this->entity_map.fill(0);
+    this->item_map.fill(0);
+    this->occupied.clear();
+    this->tunnel_costs.fill(std::numeric_limits<int32_t>::max());
+    this->terrain_costs.fill(std::numeric_limits<int32_t>::max());
+    for(TargetCostField& f : this->target_fields) f.valid = false;
+    this->regions.invalidate();
+    this->stale_dirs = 0x3;
+    this->stale_costs = 0;
+    this->dirty_cells.clear();
+
+    this->entity_queue.clear();
 
     this->pc.state.target_pos = this->pc.state.pos.assign(0, 0);
     this->npcs.clear();
@@ -347,24 +416,134 @@ void DungeonLevel::reset()
     this->npcs_remaining = 0;
 }
 
+void DungeonLevel::releaseScratch()
+{
+    this->pathing.release();
+    for(TargetCostField& f : this->target_fields)
+    {
+        f.costs = DungeonCostMap{};
+        f.valid = false;
+    }
+    this->regions = RegionGraph{};
+}
+
+// approximate heap footprint, dominated by the per-cell grids
+size_t DungeonLevel::memoryUsage() const
+{
+    size_t b = sizeof(DungeonLevel) +
+        this->map.terrain.bytes() +
+        this->tunnel_costs.bytes() +
+        this->terrain_costs.bytes() +
+        this->tunnel_dirs.bytes() +
+        this->terrain_dirs.bytes() +
+        this->visibility_map.bytes() +
+        this->entity_map.bytes() +
+        this->item_map.bytes() +
+        (this->map.floor_mask.rowWords() * 3 + this->occupied.rowWords() + this->pc_fov.rowWords()) * this->height() * sizeof(uint64_t) +
+        this->regions.region_map.bytes() +
+        this->regions.portal_map.bytes() +
+        this->pathing.bytes() +
+        this->npcs.capacity() * sizeof(Entity) +
+        this->items.capacity() * sizeof(Item*) +
+        this->free_items.capacity() * sizeof(uint16_t) +
+        this->dirty_cells.capacity() * sizeof(Vec2u16);
+
+    for(const TargetCostField& f : this->target_fields) b += f.costs.bytes();
+    for(const RegionGraph::Region& r : this->regions.regions)
+    {
+        b += r.cells.capacity() * sizeof(uint32_t) +
+            r.portals.capacity() * sizeof(Vec2u16) +
+            r.portal_dist.capacity() * sizeof(int32_t);
+    }
+    for(const Item* i : this->items)
+    {
+        if(i) b += sizeof(Item);
+    }
+
+    return b;
+}
+
 void DungeonLevel::deleteItems()
 {
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+    for(Item* i : this->items)
+    {
+        if(i) delete i;
+    }
+    this->items.clear();
+    this->free_items.clear();
+    this->item_map.fill(0);
+}
+
+Vec2u16 DungeonLevel::nthFreeFloorAfter(Vec2u16 from, uint32_t n, const BitRows& blocked) const
+{
+    const BitRows& floor = this->map.floor_mask;
+    const size_t w = this->width(), h = this->height();
+
+    // one lap is the rest of from's row, every other row, then from's row up to and including from
+    for(size_t k = 0; k <= h; k++)
     {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+        const size_t
+            y = (from.y + k) % h,
+            i0 = (k == 0 ? from.x + 1u : 0),
+            i1 = (k == h ? from.x : w - 1);
+        if(i0 > i1) continue;
+
+        const uint64_t *f = floor[y], *b = blocked[y];
+        for(size_t i = i0 / 64; i <= i1 / 64; i++)
         {
-            if(this->item_map[y][x])
+            uint64_t m = f[i] & ~b[i] & BitRows::rangeMask(i, i0, i1);
+            const uint32_t c = static_cast<uint32_t>(__builtin_popcountll(m));
+            if(n > c)
             {
-                delete this->item_map[y][x];
-                this->item_map[y][x] = nullptr;
+                n -= c;
+                continue;
             }
+            for(; n > 1; n--) m &= (m - 1);
+
+            return Vec2u16{ static_cast<uint16_t>(i * 64 + __builtin_ctzll(m)), static_cast<uint16_t>(y) };
         }
     }
+    return from;
+}
+
+void DungeonLevel::placeItem(Vec2u16 p, Item* i)
+{
+    uint16_t h;
+    if(!this->free_items.empty())
+    {
+        h = this->free_items.back();
+        this->free_items.pop_back();
+        this->items[h - 1] = i;
+    }
+    else
+    {
+        this->items.push_back(i);
+        h = static_cast<uint16_t>(this->items.size());
+    }
+    accessGridElem(this->item_map, p) = h;
+}
+
+Item* DungeonLevel::takeItem(Vec2u16 p)
+{
+    uint16_t& h = accessGridElem(this->item_map, p);
+    if(!h) return nullptr;
+
+    Item* i = this->items[h - 1];
+    this->items[h - 1] = nullptr;
+    this->free_items.push_back(h);
+    h = 0;
+
+    return i;
 }
 
 
 int DungeonLevel::loadTerrain(FILE* f)
 {
+    if(this->width() != RLG327_X_DIM || this->height() != RLG327_Y_DIM)
+    {
+        this->resize(RLG327_X_DIM, RLG327_Y_DIM);
+    }
+
 // marker, version, and size all unneeded for parsing
     int status;
     uint8_t scratch[20];
@@ -372,23 +551,25 @@ int DungeonLevel::loadTerrain(FILE* f)
 
 // read PC location
     status = fread(scratch, 1, 2, f);
-    *reinterpret_cast<uint16_t*>(this->pc.state.pos.data) = *reinterpret_cast<uint16_t*>(scratch);
+    this->pc.state.pos.assign(scratch[0], scratch[1]);
 
 // read grid
-    uint8_t dungeon_bytes[DUNGEON_Y_DIM][DUNGEON_X_DIM];
-    status = fread(dungeon_bytes, sizeof(*dungeon_bytes[0]), (DUNGEON_X_DIM * DUNGEON_Y_DIM), f);
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+    uint8_t dungeon_bytes[RLG327_Y_DIM][RLG327_X_DIM];
+    status = fread(dungeon_bytes, sizeof(*dungeon_bytes[0]), (RLG327_X_DIM * RLG327_Y_DIM), f);
+    for(size_t y = 0; y < RLG327_Y_DIM; y++)
     {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+        for(size_t x = 0; x < RLG327_X_DIM; x++)
         {
             TerrainMap::Cell& c = this->map.terrain[y][x];
 
-            if( !(this->map.hardness[y][x] = dungeon_bytes[y][x]) )
+            if( !(this->map.terrain[y][x].hardness = dungeon_bytes[y][x]) )
             {
                 c.type = TerrainMap::CELLTYPE_CORRIDOR;
             }
         }
     }
+    this->map.version++;
+    this->regions.invalidate();
 
 // read number of rooms
     uint16_t num_rooms;
@@ -406,8 +587,8 @@ int DungeonLevel::loadTerrain(FILE* f)
         TerrainMap::Room& room = this->map.rooms[r];
         room.tl.x = scratch[0];
         room.tl.y = scratch[1];
-        room.br.x = static_cast<uint8_t>(static_cast<int16_t>(scratch[0]) + scratch[2] - 1);
-        room.br.y = static_cast<uint8_t>(static_cast<int16_t>(scratch[1]) + scratch[3] - 1);
+        room.br.x = static_cast<uint16_t>(static_cast<int16_t>(scratch[0]) + scratch[2] - 1);
+        room.br.y = static_cast<uint16_t>(static_cast<int16_t>(scratch[1]) + scratch[3] - 1);
 
     #if ENABLE_DEBUG_PRINTS
         print_dungeon_room(room);
@@ -438,6 +619,7 @@ int DungeonLevel::loadTerrain(FILE* f)
         status = fread(scratch, sizeof(*scratch), 2, f);
         this->map.terrain[scratch[1]][scratch[0]].is_stair = TerrainMap::STAIR_DOWN;
     }
+    this->map.rebuildMasks();
 
     (void)status;
     return 0;
@@ -445,6 +627,8 @@ int DungeonLevel::loadTerrain(FILE* f)
 
 int DungeonLevel::saveTerrain(FILE* f)
 {
+    if(this->width() != RLG327_X_DIM || this->height() != RLG327_Y_DIM) return -1;
+
 // 1. Write file type marker
     fwrite("RLG327-S2025", 12, 1, f);
 
@@ -453,33 +637,45 @@ int DungeonLevel::saveTerrain(FILE* f)
     // version = htobe32(&version);
     fwrite(&version, sizeof(version), 1, f);
 
+// stairs can be placed on top of each other, so only count the ones that are still present
+    uint16_t num_up_stair = 0, num_down_stair = 0;
+    for(size_t i = 0; i < this->map.terrain.size(); i++)
+    {
+        num_up_stair += (this->map.terrain.data()[i].is_stair == TerrainMap::STAIR_UP);
+        num_down_stair += (this->map.terrain.data()[i].is_stair == TerrainMap::STAIR_DOWN);
+    }
+
 // 3. Write file size
-    uint32_t size = (1708U + this->map.rooms.size() * 4 + this->map.num_up_stair * 2 + this->map.num_down_stair * 2);
+    uint32_t size = (1708U + this->map.rooms.size() * 4 + num_up_stair * 2 + num_down_stair * 2);
     // PRINT_DEBUG("Writing file size of %d\n", size);
     size = htobe32(size);
     fwrite(&size, sizeof(size), 1, f);
 
 // 4. Write X and Y position of PC
-    const uint8_t* pc_loc = this->pc.state.pos.data;
+    const uint8_t pc_loc[2] =
+    {
+        static_cast<uint8_t>(this->pc.state.pos.x),
+        static_cast<uint8_t>(this->pc.state.pos.y)
+    };
     // PRINT_DEBUG("Writing PC location of (%d, %d)\n", pc_pos->x, pc_pos->y);
-    fwrite(pc_loc, sizeof(*pc_loc), (sizeof(this->pc.state.pos.data) / sizeof(*pc_loc)), f);
+    fwrite(pc_loc, sizeof(*pc_loc), (sizeof(pc_loc) / sizeof(*pc_loc)), f);
 
     uint8_t *up_stair, *down_stair;
-    up_stair = static_cast<uint8_t*>(malloc(sizeof(*up_stair) * this->map.num_up_stair * 2));
-    down_stair = static_cast<uint8_t*>(malloc(sizeof(*down_stair) * this->map.num_down_stair * 2));
+    up_stair = static_cast<uint8_t*>(malloc(sizeof(*up_stair) * num_up_stair * 2));
+    down_stair = static_cast<uint8_t*>(malloc(sizeof(*down_stair) * num_down_stair * 2));
     if(!up_stair || !down_stair) return -1;
 
 // 5. Write DungeonMap bytes
-    uint8_t dungeon_bytes[DUNGEON_Y_DIM][DUNGEON_X_DIM];
+    uint8_t dungeon_bytes[RLG327_Y_DIM][RLG327_X_DIM];
     size_t u_idx = 0, d_idx = 0;
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+    for(size_t y = 0; y < RLG327_Y_DIM; y++)
     {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+        for(size_t x = 0; x < RLG327_X_DIM; x++)
         {
             const TerrainMap::Cell c = this->map.terrain[y][x];
             switch(c.type)
             {
-                case TerrainMap::CELLTYPE_ROCK: dungeon_bytes[y][x] = this->map.hardness[y][x]; break;
+                case TerrainMap::CELLTYPE_ROCK: dungeon_bytes[y][x] = this->map.terrain[y][x].hardness; break;
                 case TerrainMap::CELLTYPE_ROOM:
                 case TerrainMap::CELLTYPE_CORRIDOR: dungeon_bytes[y][x] = 0; break;
             }
@@ -488,7 +684,7 @@ int DungeonLevel::saveTerrain(FILE* f)
             {
                 case TerrainMap::STAIR_UP:
                 {
-                    if(u_idx < this->map.num_up_stair)
+                    if(u_idx < num_up_stair)
                     {
                         up_stair[u_idx * 2 + 0] = (uint8_t)x;
                         up_stair[u_idx * 2 + 1] = (uint8_t)y;
@@ -498,7 +694,7 @@ int DungeonLevel::saveTerrain(FILE* f)
                 }
                 case TerrainMap::STAIR_DOWN:
                 {
-                    if(d_idx < this->map.num_down_stair)
+                    if(d_idx < num_down_stair)
                     {
                         down_stair[d_idx * 2 + 0] = (uint8_t)x;
                         down_stair[d_idx * 2 + 1] = (uint8_t)y;
@@ -511,7 +707,7 @@ int DungeonLevel::saveTerrain(FILE* f)
             }
         }
     }
-    fwrite(dungeon_bytes, sizeof(*dungeon_bytes[0]), (DUNGEON_X_DIM * DUNGEON_Y_DIM), f);
+    fwrite(dungeon_bytes, sizeof(*dungeon_bytes[0]), (RLG327_X_DIM * RLG327_Y_DIM), f);
 
 // 6. Write number of rooms in DungeonMap
     // PRINT_DEBUG("Writing num rooms: %x\n", d->num_rooms);
@@ -535,20 +731,20 @@ int DungeonLevel::saveTerrain(FILE* f)
     }
 
 // 8. Write the number of upward staircases
-    // PRINT_DEBUG("Writing number of up staircases: %d\n", this->map.num_up_stair);
-    uint16_t num_up = htobe16(this->map.num_up_stair);
+    // PRINT_DEBUG("Writing number of up staircases: %d\n", num_up_stair);
+    uint16_t num_up = htobe16(num_up_stair);
     fwrite(&num_up, sizeof(num_up), 1, f);
 
 // 9. Write each upward staircase
-    fwrite(up_stair, sizeof(*up_stair), this->map.num_up_stair * 2, f);
+    fwrite(up_stair, sizeof(*up_stair), num_up_stair * 2, f);
 
 // 10. Write the number of downward staircases
-    // PRINT_DEBUG("Writing number of down staircases: %d\n", this->map.num_down_stair);
-    uint16_t num_down = htobe16(this->map.num_down_stair);
+    // PRINT_DEBUG("Writing number of down staircases: %d\n", num_down_stair);
+    uint16_t num_down = htobe16(num_down_stair);
     fwrite(&num_down, sizeof(num_down), 1, f);
 
 // 11. Write each downward staircase
-    fwrite(down_stair, sizeof(*down_stair), this->map.num_down_stair * 2, f);
+    fwrite(down_stair, sizeof(*down_stair), num_down_stair * 2, f);
 
     free(up_stair);
     free(down_stair);
@@ -559,6 +755,7 @@ int DungeonLevel::saveTerrain(FILE* f)
 int DungeonLevel::generateTerrain()
 {
     this->map.generate(this->rgen());
+    this->regions.invalidate();
 
     return 0;
 }
@@ -567,78 +764,272 @@ int DungeonLevel::generateTerrain()
 
 int DungeonLevel::updateCosts(bool both_or_only_terrain)
 {
-    static PathFindingBuffer buff;
-    static int buff_inited = 0;
-    if(!buff_inited)
+    PathFindingBuffer& buff = this->pathing.buff;
+
+    if(both_or_only_terrain)
     {
-        init_pathing_buffer(buff);
-        buff_inited = 1;
+    #if DUNGEON_USE_BITWISE_BFS
+        dungeon_bitwise_traverse_floor(this->pathing, this->map, this->pc.state.pos, this->tunnel_costs);
+    #else
+        dungeon_dijkstra_traverse_floor(this->pathing, this->map, this->pc.state.pos);
+        for(size_t i = 0; i < buff.size(); i++)
+        {
+            this->tunnel_costs.data()[i] = buff.data()[i].cost;
+        }
+    #endif
     }
+    dungeon_dijkstra_traverse_terrain(this->pathing, this->map, this->pc.state.pos);
+    for(size_t i = 0; i < buff.size(); i++)
+    {
+        this->terrain_costs.data()[i] = buff.data()[i].cost;
+    }
+    this->stale_dirs |= (both_or_only_terrain ? 0x3 : 0x2);
 
-    if(both_or_only_terrain)
+    // the queued edits are only still needed for a floor map that wasn't rebuilt
+    this->stale_costs = both_or_only_terrain ? 0 : (this->stale_costs & 0x1);
+    if(!this->stale_costs) this->dirty_cells.clear();
+
+    return 0;
+}
+
+void DungeonLevel::invalidateCosts()
+{
+    this->stale_costs = 0x7;
+    this->dirty_cells.clear();
+    this->cost_updates.requested++;
+}
+
+int DungeonLevel::refreshCosts()
+{
+    if(!this->stale_costs) return 0;
+    this->cost_updates.run++;
+
+    if(this->stale_costs & 0x4) return this->updateCosts(true);
+
+    const bool floor = this->stale_costs & 0x1;
+    const Vec2u16* cells = this->dirty_cells.data();
+    const size_t n = this->dirty_cells.size();
+    if( (floor && dungeon_dijkstra_repair_floor(this->pathing, this->map, this->tunnel_costs, cells, n)) ||
+        dungeon_dijkstra_repair_terrain(this->pathing, this->map, this->terrain_costs, cells, n) )
+    {
+        return this->updateCosts(floor);
+    }
+    this->stale_dirs |= (floor ? 0x3 : 0x2);
+    this->stale_costs = 0;
+    this->dirty_cells.clear();
+
+#if INCREMENTAL_COSTS_DEBUG
+    PathFindingBuffer& buff = this->pathing.buff;
+
+    size_t mismatches = 0;
+    dungeon_dijkstra_traverse_floor(this->pathing, this->map, this->pc.state.pos);
+    for(size_t i = 0; i < buff.size(); i++)
+    {
+        mismatches += (this->tunnel_costs.data()[i] != buff.data()[i].cost);
+    }
+    dungeon_dijkstra_traverse_terrain(this->pathing, this->map, this->pc.state.pos);
+    for(size_t i = 0; i < buff.size(); i++)
+    {
+        mismatches += (this->terrain_costs.data()[i] != buff.data()[i].cost);
+    }
+    assert(!mismatches);
+#endif
+
+    return 0;
+}
+
+// queues a single cell whose hardness was lowered or that became floor
+void DungeonLevel::updateCostsAt(Vec2u16 edited, bool both_or_only_terrain)
+{
+    this->cost_updates.requested++;
+    if(!(this->stale_costs & 0x4))
+    {
+        this->stale_costs |= (both_or_only_terrain ? 0x3 : 0x2);
+        if(std::find(this->dirty_cells.begin(), this->dirty_cells.end(), edited) == this->dirty_cells.end())
+        {
+            this->dirty_cells.push_back(edited);
+        }
+    }
+
+    // cached target fields one edit behind can be carried forward the same way
+    for(TargetCostField& f : this->target_fields)
+    {
+        if(!f.valid || f.terrain_version + 1 != this->map.version) continue;
+
+        if(f.tunneling || both_or_only_terrain)
+        {
+            f.valid = !( f.tunneling ?
+                dungeon_dijkstra_repair_terrain(this->pathing, this->map, f.costs, &edited, 1) :
+                dungeon_dijkstra_repair_floor(this->pathing, this->map, f.costs, &edited, 1) );
+        }
+        f.terrain_version = this->map.version;
+    }
+}
+
+// Stores the index of the cheapest neighbor for every interior cell, using the same
+// tie-breaking as a linear scan over MOVE_OFFSETS.
+static void build_direction_map(const DungeonLevel::DungeonCostMap& costs, DungeonLevel::DirectionMap& dirs)
+{
+    for(size_t y = 1; y < costs.height() - 1; y++)
     {
-        dungeon_dijkstra_traverse_floor(this->map, this->pc.state.pos, buff);
-        for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+        for(size_t x = 1; x < costs.width() - 1; x++)
         {
-            for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+            uint32_t min_d = 0;
+            int32_t min_cost = costs[y + DungeonLevel::MOVE_OFFSETS[0][1]][x + DungeonLevel::MOVE_OFFSETS[0][0]];
+            for(uint32_t d = 1; d < 8; d++)
             {
-                this->tunnel_costs[y][x] = buff[y][x].cost;
+                const int32_t c = costs[y + DungeonLevel::MOVE_OFFSETS[d][1]][x + DungeonLevel::MOVE_OFFSETS[d][0]];
+                if(c < min_cost)
+                {
+                    min_d = d;
+                    min_cost = c;
+                }
             }
+            dirs.set(x, y, min_d);
         }
     }
-    dungeon_dijkstra_traverse_terrain(this->map, this->pc.state.pos, buff);
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+}
+
+// returns the next-step direction map toward the PC, rebuilding it if the cost map changed
+const DungeonLevel::DirectionMap& DungeonLevel::getCostDirections(bool tunneling)
+{
+    const uint8_t bit = tunneling ? 0x2 : 0x1;
+    DirectionMap& dirs = tunneling ? this->terrain_dirs : this->tunnel_dirs;
+
+    this->refreshCosts();
+    if(this->stale_dirs & bit)
     {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+        build_direction_map(tunneling ? this->terrain_costs : this->tunnel_costs, dirs);
+        this->stale_dirs &= ~bit;
+    }
+    return dirs;
+}
+
+const DungeonLevel::DungeonCostMap* DungeonLevel::findTargetCosts(Vec2u16 target, bool tunneling) const
+{
+    for(const TargetCostField& f : this->target_fields)
+    {
+        if( f.valid &&
+            f.target == target &&
+            f.tunneling == tunneling &&
+            f.terrain_version == this->map.version )
         {
-            this->terrain_costs[y][x] = buff[y][x].cost;
+            return &f.costs;
         }
     }
+    return nullptr;
+}
 
-    return 0;
+// returns the distance field toward target, computing it only if no valid cached copy exists
+const DungeonLevel::DungeonCostMap& DungeonLevel::getTargetCosts(Vec2u16 target, bool tunneling)
+{
+    PathFindingBuffer& buff = this->pathing.buff;
+
+    TargetCostField* slot = &this->target_fields[0];
+    for(TargetCostField& f : this->target_fields)
+    {
+        if( f.valid &&
+            f.target == target &&
+            f.tunneling == tunneling &&
+            f.terrain_version == this->map.version )
+        {
+            f.last_used = ++this->target_fields_clock;
+            return f.costs;
+        }
+        if(!f.valid || (slot->valid && f.last_used < slot->last_used)) slot = &f;
+    }
+
+    if(slot->costs.width() != this->width() || slot->costs.height() != this->height())
+    {
+        slot->costs.resize(this->width(), this->height());
+    }
+
+    // traversing outward from the target gives every cell its path cost toward the target
+#if DUNGEON_USE_BITWISE_BFS
+    if(!tunneling) dungeon_bitwise_traverse_floor(this->pathing, this->map, target, slot->costs);
+    else
+#endif
+    {
+        if(tunneling) dungeon_dijkstra_traverse_terrain(this->pathing, this->map, target);
+        else dungeon_dijkstra_traverse_floor(this->pathing, this->map, target);
+        for(size_t i = 0; i < buff.size(); i++)
+        {
+            slot->costs.data()[i] = buff.data()[i].cost;
+        }
+    }
+
+    slot->target = target;
+    slot->tunneling = tunneling;
+    slot->terrain_version = this->map.version;
+    slot->last_used = ++this->target_fields_clock;
+    slot->valid = true;
+
+    return slot->costs;
 }
 
 int DungeonLevel::copyVisCells()
 {
-    for(size_t i = 0; i < 21; i++)
-    {
-        const auto v = VIS_OFFSETS[i];
-        const int8_t y = static_cast<int8_t>(this->pc.state.pos.y) + v[0];
-        const int8_t x = static_cast<int8_t>(this->pc.state.pos.x) + v[1];
+    const int32_t
+        w = this->width(),
+        h = this->height(),
+        radius = FOV_RADIUS > 0 ? FOV_RADIUS : std::max(w, h);
+
+    this->pc_fov.clear();
+    shadowcast(
+        this->pc.state.pos.x,
+        this->pc.state.pos.y,
+        radius,
+        [&](int32_t x, int32_t y)
+        {
+            return x < 0 || y < 0 || x >= w || y >= h || !this->map.floor_mask.test(y, x);
+        },
+        [&](int32_t x, int32_t y)
+        {
+            if(x >= 0 && y >= 0 && x < w && y < h) this->pc_fov.set(y, x);
+        } );
 
-        if(y >= 0 && y < DUNGEON_Y_DIM && x >= 0 && x < DUNGEON_X_DIM)
+    // only the lit part of the view is remembered on the fog map
+    const Vec2u16 p = this->pc.state.pos;
+    for(int32_t y = std::max<int32_t>(p.y - LIGHT_RADIUS, 0); y <= std::min<int32_t>(p.y + LIGHT_RADIUS, h - 1); y++)
+    {
+        for(int32_t x = std::max<int32_t>(p.x - LIGHT_RADIUS, 0); x <= std::min<int32_t>(p.x + LIGHT_RADIUS, w - 1); x++)
         {
-            this->visibility_map[y][x] = this->map.terrain[y][x].getChar();
+            if(this->isLit(Vec2u16{ x, y }))
+            {
+                this->visibility_map[y][x] = this->map.terrain[y][x].getChar();
+            }
         }
     }
 
     return 0;
 }
 
-void DungeonLevel::writeChar(WINDOW* win, Vec2u8 loc)
+// draws the cell at loc relative to the level cell shown at the window's top left corner
+void DungeonLevel::writeChar(WINDOW* win, Vec2u16 loc, Vec2u16 origin)
 {
-    const bool lit = (loc.cast<int>() - this->pc.state.pos).lensquared() <= VIS_RADSQ;
+    const bool lit = this->isLit(loc);
+    const int wy = loc.y - origin.y, wx = loc.x - origin.x;
 
     if(lit) wattron(win, A_BOLD);
 
-    if(Entity* e = DungeonLevel::accessGridElem(this->entity_map, loc); e)
+    if(Entity* e = this->entityAt(loc); e)
     {
         const short c = e->getColor();
         wattron(win, COLOR_PAIR(c));
-        mvwaddch(win, loc.y, loc.x, e->getChar());
+        mvwaddch(win, wy, wx, e->getChar());
         wattroff(win, COLOR_PAIR(c));
     }
     else
-    if(Item* i = DungeonLevel::accessGridElem(this->item_map, loc); i)
+    if(Item* i = this->itemAt(loc); i)
     {
         const short c = i->getColor();
         wattron(win, COLOR_PAIR(c));
-        mvwaddch(win, loc.y, loc.x, i->getChar());
+        mvwaddch(win, wy, wx, i->getChar());
         wattroff(win, COLOR_PAIR(c));
     }
     else
     {
-        mvwaddch(win, loc.y, loc.x, DungeonLevel::accessGridElem(this->map.terrain, loc).getChar());
+        mvwaddch(win, wy, wx, DungeonLevel::accessGridElem(this->map.terrain, loc).getChar());
     }
 
     if(lit) wattroff(win, A_BOLD);
@@ -6,6 +6,7 @@
 #include <memory>
 #include <random>
 #include <vector>
+#include <utility>
 #include <array>
 #include <queue>
 
@@ -13,6 +14,12 @@
 
 #include "util/vec_geom.hpp"
 #include "util/math.hpp"
+#include "util/bucket_queue.hpp"
+#include "util/grid.hpp"
+#include "util/bit_rows.hpp"
+#include "util/packed_grid.hpp"
+#include "util/thread_pool.hpp"
+#include "util/turn_wheel.hpp"
 #include "util/heap.h"
 
 #include "dungeon_config.h"
@@ -20,12 +27,56 @@
 #include "spawning.hpp"
 
 
+class CellPathNode
+{
+public:
+    HeapNode* hn;
+    Vec2u16 pos;
+    Vec2u16 from;
+    int32_t cost;
+    int32_t priority;
+    uint32_t visit;
+    uint16_t source;    // nearest seed group of multi-source traversals (fits in padding)
+};
+
+using PathFindingBuffer = Grid<CellPathNode>;
+
+/* Scratch state for the pathing kernels. A context must only be used by one
+ * thread at a time -- each DungeonLevel owns one, and PathingContext::local()
+ * provides a per-thread context for everything else (ex. terrain generation).
+ * Every kernel resizes the context to the level it is run on, which is a
+ * no-op unless the level size changed. Traversal results are left in buff. */
+struct PathingContext
+{
+    PathFindingBuffer buff;
+    BucketQueue queue;
+    HeapNodeArena heap_nodes;       // one node per cell, since cells are inserted at most once per search
+    std::vector<std::pair<int32_t, uint32_t>> seeds;
+    BitRows bfs_seen, bfs_front[2], bfs_grow;
+
+    uint32_t visit_stamp{ 0 };
+    size_t expanded_nodes{ 0 };     // cells expanded by single path searches
+
+    PathingContext();
+    PathingContext(const PathingContext&) = delete;
+    ~PathingContext();
+
+    void resize(size_t w, size_t h);
+    // frees every buffer -- the next kernel run on the context sizes them again
+    void release();
+    size_t bytes() const;
+
+    static PathingContext& local();
+};
+
+
 class DungeonLevel
 {
 public:
     template<typename T>
-    using DungeonGrid = T[DUNGEON_Y_DIM][DUNGEON_X_DIM];
+    using DungeonGrid = Grid<T>;
     using DungeonCostMap = DungeonGrid<int32_t>;
+    using DirectionMap = PackedGrid<3>;     // indices into MOVE_OFFSETS
 
     template<typename T, typename I>
     static inline T& accessGridElem(DungeonLevel::DungeonGrid<T>& grid, const geom::Vec2_<I>& p)
@@ -35,35 +86,54 @@ public:
         return grid[p.y][p.x];
     }
 
-    static inline constexpr int8_t VIS_OFFSETS[21][2] =   // (Y, X)
+    static inline constexpr int8_t MOVE_OFFSETS[8][2] =    // (X, Y)
     {
-        { -2, -1 },
-        { -2, 0 },
-        { -2, 1 },
-
-        { -1, -2 },
+        { +1,  0 },
+        {  0, -1 },
+        { -1,  0 },
+        {  0, +1 },
+        { +1, +1 },
+        { +1, -1 },
         { -1, -1 },
-        { -1, 0 },
-        { -1, 1 },
-        { -1, 2 },
-
-        { 0, -2 },
-        { 0, -1 },
-        { 0, 0 },
-        { 0, 1 },
-        { 0, 2 },
-
-        { 1, -2 },
-        { 1, -1 },
-        { 1, 0 },
-        { 1, 1 },
-        { 1, 2 },
-
-        { 2, -1 },
-        { 2, 0 },
-        { 2, 1 },
+        { -1, +1 },
     };
-    static inline constexpr uint8_t VIS_RADSQ = 5;
+
+    static inline constexpr uint64_t TURN_RNG_STREAM = 0x5eed;
+    // entity handles are 16 bits, with 0 for empty cells and 1 for the PC
+    static inline constexpr size_t MAX_NPCS = 0xFFFF - 2;
+
+    static inline constexpr int32_t LIGHT_RADIUS = DUNGEON_PC_LIGHT_RADIUS;
+    // 0 leaves sight unbounded (up to the level's extent)
+    static inline constexpr int32_t FOV_RADIUS = DUNGEON_FOV_RADIUS;
+
+    // bit d of entry (above | center << 3 | below << 6), each 3 columns wide, is set if MOVE_OFFSETS[d] is
+    static inline constexpr std::array<uint8_t, 512> NEIGHBOR_DIRS = []()
+    {
+        std::array<uint8_t, 512> t{};
+        for(uint32_t m = 0; m < 512; m++)
+        {
+            for(uint32_t d = 0; d < 8; d++)
+            {
+                const uint32_t bit = (MOVE_OFFSETS[d][1] + 1) * 3 + (MOVE_OFFSETS[d][0] + 1);
+                if((m >> bit) & 0x1) t[m] |= (1 << d);
+            }
+        }
+        return t;
+    }();
+
+    // bit d is set if the cell at MOVE_OFFSETS[d] from p is set in rows -- p must not be on the border
+    static inline uint8_t neighborMask(const BitRows& rows, Vec2u16 p)
+    {
+        const size_t i = p.x - 1u, w = i / 64, b = i % 64;
+        const auto bits3 = [w, b](const uint64_t* r)
+        {
+            uint64_t v = r[w] >> b;
+            if(b > 61) v |= r[w + 1] << (64 - b);
+            return static_cast<uint32_t>(v & 0x7);
+        };
+
+        return NEIGHBOR_DIRS[bits3(rows[p.y - 1]) | (bits3(rows[p.y]) << 3) | (bits3(rows[p.y + 1]) << 6)];
+    }
 
 public:
     struct TerrainMap
@@ -89,6 +159,7 @@ public:
         {
             uint8_t type : REQUIRED_BITS32(CELLTYPE_MAX_VALUE - 1);
             uint8_t is_stair : REQUIRED_BITS32(STAIR_MAX_VALUE - 1);
+            uint8_t hardness;   // packed with the type so that neighbor scans load a single cell
 
             char getChar() const;
             inline bool isFloor() const { return static_cast<bool>(this->type); }
@@ -97,53 +168,73 @@ public:
         };
         struct Room
         {
-            Vec2u8 tl{ 0, 0 }, br{ 0, 0 };
+            Vec2u16 tl{ 0, 0 }, br{ 0, 0 };
 
-            inline Vec2u8 size() const { return br - tl + Vec2u8{ 1, 1 }; }
+            inline Vec2u16 size() const { return br - tl + Vec2u16{ 1, 1 }; }
             bool collides(const Room& r) const;
         };
 
     public:
         DungeonGrid<Cell> terrain;
-        DungeonGrid<uint8_t> hardness;
 
         std::vector<Room> rooms;
 
         uint16_t num_up_stair{ 0 }, num_down_stair{ 0 };
+        uint32_t version{ 0 };  // bumped whenever terrain or hardness changes
+
+        /* Row bitboards of the cells, rebuilt by reset(), generate() and
+         * loadTerrain(), and kept current by makeCorridor(). Rock is the
+         * complement of floor_mask, solid_mask is rock that can't be tunneled. */
+        BitRows floor_mask, stair_mask, solid_mask;
 
     public:
-        inline TerrainMap() = default;
+        inline TerrainMap() { this->resize(DUNGEON_X_DIM, DUNGEON_Y_DIM); }
         inline ~TerrainMap() = default;
 
+        inline uint16_t width() const { return static_cast<uint16_t>(this->terrain.width()); }
+        inline uint16_t height() const { return static_cast<uint16_t>(this->terrain.height()); }
+
+        void resize(uint16_t w, uint16_t h);
         void reset();
         void generate(uint32_t seed);
+        void rebuildMasks();
         inline void generateClean(uint32_t seed)
         {
             this->reset();
             this->generate(seed);
         }
 
+        // callers bump version
+        inline void makeCorridor(Vec2u16 c)
+        {
+            Cell& cell = this->terrain[c.y][c.x];
+            cell.type = CELLTYPE_CORRIDOR;
+            cell.hardness = 0;
+            this->floor_mask.set(c.y, c.x);
+            this->solid_mask.reset(c.y, c.x);
+        }
+
         template<typename G = std::mt19937>
-        inline Vec2u8 randomRoomFloorPos(G& gen)
+        inline Vec2u16 randomRoomFloorPos(G& gen)
         {
             std::uniform_int_distribution<size_t>
                 room_idx_distribution{ 0, this->rooms.size() - 1 };
 
             const Room& room = this->rooms[room_idx_distribution(gen)];
-            return Vec2u8::randomInRange(room.tl, room.br, gen);
+            return Vec2u16::randomInRange(room.tl, room.br, gen);
         }
 
     };
 
     struct EntityQueueNode
     {
-        inline EntityQueueNode(Entity* e, size_t n, uint8_t p) :
+        inline EntityQueueNode(Entity* e, size_t n, uint32_t p) :
             e{ e }, next_turn{ n }, priority{ p }
         {}
 
         Entity* e{ nullptr };
         size_t next_turn{ 0 };
-        uint8_t priority{ 0 };
+        uint32_t priority{ 0 };     // unique per entity, breaks ties between nodes due on the same turn
 
         inline bool operator<(const EntityQueueNode& other) const
         {
@@ -152,30 +243,124 @@ public:
         }
     };
 
+    // reverse distance field toward a single target, shared by every monster heading there
+    struct TargetCostField
+    {
+        DungeonCostMap costs;
+        Vec2u16 target{ 0, 0 };
+        uint32_t terrain_version{ 0 };
+        uint32_t last_used{ 0 };
+        bool tunneling{ false };
+        bool valid{ false };
+    };
+
+    /* HPA* style abstraction of the floor for routing non-tunneling monsters on
+     * large levels. Floor cells are split into regions -- one per room, plus each
+     * 8-connected run of corridor -- and every cell bordering another region is a
+     * portal. Portals are linked to the other portals of their region by in-region
+     * distance and to touching portals of neighboring regions, so a coarse search
+     * over portals followed by a local search inside the start region gives exact
+     * floor distances. Regions touched by tunneling are rebuilt lazily. */
+    struct RegionGraph
+    {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+        struct Region
+        {
+            std::vector<uint32_t> cells;        // y * width + x
+            std::vector<Vec2u16> portals;
+            std::vector<int32_t> portal_dist;   // in-region distance between every pair of portals
+            bool dirty{ true };
+        };
+
+    public:
+        Grid<uint32_t> region_map;      // region of each cell, NONE for rock
+        Grid<uint32_t> portal_map;      // index of each portal in its region's list, NONE otherwise
+        std::vector<Region> regions;    // the first map.rooms.size() regions are the rooms
+        std::vector<uint32_t> dirty_regions;
+        std::vector<uint32_t> node_base;    // global portal id of each region's first portal
+        std::vector<uint32_t> node_region;
+        bool valid{ false };
+        bool stale_nodes{ true };
+
+    public:
+        inline void invalidate() { this->valid = false; }
+        // brings the graph up to date with the map, rebuilding it entirely if it was invalidated
+        void update(const TerrainMap& map);
+        // call after a rock cell became corridor
+        void addFloorCell(const TerrainMap& map, Vec2u16 c);
+        // true if update() would have nothing to do
+        bool isCurrent(const TerrainMap& map) const;
+        // first move of a shortest floor path, false if to is unreachable (or is from)
+        bool nextStep(const TerrainMap& map, Vec2u16 from, Vec2u16 to, Vec2u16& step);
+        // same as nextStep() on a graph that is already current -- safe to call concurrently
+        bool firstStep(Vec2u16 from, Vec2u16 to, Vec2u16& step) const;
+
+        inline size_t numPortals() const { return this->node_region.size(); }
+
+    protected:
+        void build(const TerrainMap& map);
+        void refreshRegion(uint32_t r);
+        void markDirty(uint32_t r);
+
+    };
+
 public:
     inline DungeonLevel() :
-        pc{ Entity::PCGenT{} },
-        rroll{ std::random_device{}() }
+        pc{ Entity::PCGenT{} }
     {
-        this->reset();
+        this->resize(DUNGEON_X_DIM, DUNGEON_Y_DIM);
     }
     ~DungeonLevel();
 
-    inline void setSeed(uint32_t s) { this->rgen.seed(s); }
+    // seeds generation and, on its own stream, the turn rng
+    inline void setSeed(uint32_t s)
+    {
+        this->rgen.seed(s);
+        this->rng.seed(s, TURN_RNG_STREAM);
+    }
     inline int getWinLose() const { return this->win_lose; }
 
+    inline uint16_t width() const { return this->map.width(); }
+    inline uint16_t height() const { return this->map.height(); }
+
+    void resize(uint16_t w, uint16_t h);
     void reset();
     void deleteItems();
+    // frees state that is rebuilt on demand (pathing scratch, cached fields, region graph)
+    void releaseScratch();
+    size_t memoryUsage() const;
 
     int loadTerrain(FILE* f);
     int saveTerrain(FILE* f);
     int generateTerrain();
 
+    // rebuilds the PC cost maps right away
     int updateCosts(bool both_or_only_terrain = true);
+    /* Cost map updates are deferred until the maps are next read. Edits queue the
+     * cell (whose hardness was lowered or that became floor) for a single batched
+     * repair, and PC moves queue a full rebuild. refreshCosts() must be called
+     * before tunnel_costs or terrain_costs are read directly. */
+    void updateCostsAt(Vec2u16 edited, bool both_or_only_terrain = true);
+    void invalidateCosts();
+    int refreshCosts();
+    inline size_t costUpdatesAvoided() const { return this->cost_updates.requested - this->cost_updates.run; }
+    const DungeonCostMap& getTargetCosts(Vec2u16 target, bool tunneling);
+    // the cached field toward target if it is current, otherwise null
+    const DungeonCostMap* findTargetCosts(Vec2u16 target, bool tunneling) const;
+    const DirectionMap& getCostDirections(bool tunneling);
+    // recomputes the PC's field of view and remembers the lit part of it in visibility_map
     int copyVisCells();
 
-    int handlePCMove(Vec2u8 to, bool is_goto);
+    int handlePCMove(Vec2u16 to, bool is_goto);
     int iterateNPC(Entity& e);
+    /* Resolves the turns of NPCs due on the same tick, given in queue order. Moves
+     * are planned concurrently against the level as it stands, then applied one at
+     * a time in that order with the usual attack/displacement rules. An NPC that
+     * was displaced before its turn came up, or whose plan needed a field that
+     * wasn't cached, is replanned serially right before it is applied. */
+    void iterateNPCs(Entity* const* npcs, size_t n, ThreadPool& pool);
 
     int32_t rollPCDamage();
     int32_t getPCSpeed();
@@ -185,86 +370,195 @@ public:
     void handleItemDrop(Item& i);
     void handleItemDelete(size_t idx);
 
-    void writeChar(WINDOW* win, Vec2u8 loc);
+    void writeChar(WINDOW* win, Vec2u16 loc, Vec2u16 origin);
+
+protected:
+    // an NPC's move for one turn, decided without changing the level
+    struct NPCPlan
+    {
+        enum : uint8_t
+        {
+            NONE = 0,
+            MOVE,       // to the cell `to`
+            RANDOM,     // in a random valid direction
+            DEFER       // needs shared state rebuilt first
+        };
+
+        Vec2u16 from, to;
+        uint32_t r{ 0 };
+        uint8_t type{ NONE };
+    };
+
+    // with shared_only set, nothing outside of e is modified and plans needing a rebuild are deferred
+    void planNPC(Entity& e, uint32_t r, bool shared_only, NPCPlan& plan);
+    int applyNPC(Entity& e, const NPCPlan& plan);
+
+public:
+
+    /* Monsters see the PC exactly when their cell is in the PC's field of view.
+     * This is a definition rather than a per-monster sight check: shadowcasting
+     * is not symmetric, so near wall corners a monster may count as seeing a
+     * PC that a ray from its own cell would not reach, or the other way round.
+     * Lit cells are the ones within the PC's light radius that it can also see. */
+    inline bool inPCView(Vec2u16 p) const { return this->pc_fov.test(p.y, p.x); }
+    inline bool isLit(Vec2u16 p) const
+    {
+        return this->inPCView(p) &&
+            (p.cast<int>() - this->pc.state.pos).lensquared() <= LIGHT_RADIUS * LIGHT_RADIUS + LIGHT_RADIUS;
+    }
+
+    /* Cells refer to entities and items through 16 bit handles, 0 being empty.
+     * Entity handle 1 is the PC and n + 2 is npcs[n] (npcs must not grow once
+     * placed, and holds at most MAX_NPCS entities), item handle n + 1 is items[n]. */
+    inline Entity* entityFromHandle(uint16_t h) { return h ? (h == 1 ? &this->pc : &this->npcs[h - 2]) : nullptr; }
+    inline uint16_t entityHandle(const Entity* e) const
+    {
+        return e ? (e == &this->pc ? 1 : static_cast<uint16_t>(e - this->npcs.data() + 2)) : 0;
+    }
+    inline Entity* entityAt(Vec2u16 p) { return this->entityFromHandle(accessGridElem(this->entity_map, p)); }
+    inline void setEntityAt(Vec2u16 p, const Entity* e)
+    {
+        accessGridElem(this->entity_map, p) = this->entityHandle(e);
+        if(e) this->occupied.set(p.y, p.x);
+        else this->occupied.reset(p.y, p.x);
+    }
+    // the n-th (n > 0) floor cell after from in row-major order, wrapping around, that isn't set in
+    // blocked -- from itself if one full lap has fewer than n
+    Vec2u16 nthFreeFloorAfter(Vec2u16 from, uint32_t n, const BitRows& blocked) const;
+
+    inline Item* itemAt(Vec2u16 p)
+    {
+        const uint16_t h = accessGridElem(this->item_map, p);
+        return h ? this->items[h - 1] : nullptr;
+    }
+    // the level takes ownership -- the cell must not hold an item already
+    void placeItem(Vec2u16 p, Item* i);
+    // ownership passes to the caller
+    Item* takeItem(Vec2u16 p);
 
 public:
     TerrainMap map;
     DungeonCostMap tunnel_costs, terrain_costs;
+    DirectionMap tunnel_dirs, terrain_dirs;     // next step toward the PC, rebuilt lazily from the cost maps
+    uint8_t stale_dirs{ 0x3 };                  // bit 0 : tunnel_dirs, bit 1 : terrain_dirs
+    uint8_t stale_costs{ 0 };                   // bit 0 : tunnel_costs, bit 1 : terrain_costs, bit 2 : needs full rebuild
+    std::vector<Vec2u16> dirty_cells;           // edits not yet repaired into the stale cost maps
+    struct
+    {
+        size_t requested{ 0 };
+        size_t run{ 0 };
+    }
+    cost_updates;
+    PathingContext pathing;
+    std::array<TargetCostField, DUNGEON_TARGET_FIELD_CACHE_SIZE> target_fields;
+    uint32_t target_fields_clock{ 0 };
+    RegionGraph regions;
     DungeonGrid<char> visibility_map;
+    BitRows pc_fov;                     // cells in line of sight of the PC, as of its last move
 
-    DungeonGrid<Entity*> entity_map;
-    DungeonGrid<Item*> item_map;    // pointers here are OWNED!
+    DungeonGrid<uint16_t> entity_map;
+    DungeonGrid<uint16_t> item_map;
+    BitRows occupied;                   // cells with an entity
+    std::vector<Item*> items;           // OWNED, null slots are listed in free_items
+    std::vector<uint16_t> free_items;
 
-    std::priority_queue<EntityQueueNode> entity_queue;
+    TurnWheel<EntityQueueNode, DUNGEON_TURN_WHEEL_BITS> entity_queue;
 
     Entity pc;
     std::vector<Entity> npcs;
     // std::vector<std::shared_ptr<Item>> items;
 
-    std::array<Item*, 12> pc_equipment;
-    std::array<Item*, 10> pc_carry;
+    std::array<Item*, 12> pc_equipment{};
+    std::array<Item*, 10> pc_carry{};
 
     size_t npcs_remaining;
     int win_lose = 0;
 
     // uint32_t seed{ 0 };
     std::mt19937 rgen;
-    std::mt19937 rroll;
+    Pcg32 rng;      // everything random once the level is being played
 
 };
 
 
 
 
-class CellPathNode
-{
-public:
-    HeapNode* hn;
-    Vec2u8 pos;
-    Vec2u8 from;
-    int32_t cost;
-};
-
-using PathFindingBuffer = DungeonLevel::DungeonGrid<CellPathNode>;
-
-int init_pathing_buffer(PathFindingBuffer buff);
+int init_pathing_buffer(PathFindingBuffer& buff);
 
+// a nonzero min_weight (the smallest weight any usable cell can have) enables the A* heuristic
 int dungeon_dijkstra_single_path(
-    PathFindingBuffer buff,
+    PathingContext& ctx,
     const DungeonLevel::TerrainMap& map,
     void* out,
-    Vec2u8 from,
-    Vec2u8 to,
-    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    void(*on_cell_path)(void*, uint8_t x, uint8_t y),
-    int use_diag = true );
+    Vec2u16 from,
+    Vec2u16 to,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    void(*on_cell_path)(void*, uint16_t x, uint16_t y),
+    int use_diag = true,
+    int32_t min_weight = 0 );
+// a nonzero max_weight no larger than DUNGEON_PATHING_BUCKET_MAX_WEIGHT selects the bucket queue engine
 int dungeon_dijkstra_traverse_grid(
-    PathFindingBuffer buff,
+    PathingContext& ctx,
     const DungeonLevel::TerrainMap& map,
-    Vec2u8 from,
-    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int use_diag = true );
-Vec2u8 dungeon_dijkstra_find_nearest(
-    PathFindingBuffer buff,
+    Vec2u16 from,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int use_diag = true,
+    int32_t max_weight = 0 );
+// Repairs a cost map produced by dungeon_dijkstra_traverse_grid after the weights of the given cells
+// were lowered (or the cells became usable). Returns -1 if a full traversal is required instead.
+int dungeon_dijkstra_repair_grid(
+    PathingContext& ctx,
+    DungeonLevel::DungeonCostMap& costs,
+    const DungeonLevel::TerrainMap& map,
+    const Vec2u16* cells,
+    size_t n_cells,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int use_diag,
+    int32_t max_weight );
+Vec2u16 dungeon_dijkstra_find_nearest(
+    PathingContext& ctx,
     const DungeonLevel& l,
-    Vec2u8 from,
-    int(*should_use_cell)(const DungeonLevel&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel&, uint8_t x, uint8_t y),
-    bool(*does_qualify)(const DungeonLevel&, uint8_t x, uint8_t y),
+    Vec2u16 from,
+    int(*should_use_cell)(const DungeonLevel&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel&, uint16_t x, uint16_t y),
+    bool(*does_qualify)(const DungeonLevel&, uint16_t x, uint16_t y),
     int use_diag = true );
 
-int dungeon_dijkstra_corridor_path(DungeonLevel::TerrainMap& map, Vec2u8 from, Vec2u8 to);
-int dungeon_dijkstra_traverse_floor(DungeonLevel::TerrainMap& map, Vec2u8 from, PathFindingBuffer buff);
-int dungeon_dijkstra_traverse_terrain(DungeonLevel::TerrainMap& map, Vec2u8 from, PathFindingBuffer buff);
-Vec2u8 dungeon_dijkstra_nearest_open_drop(DungeonLevel& l, Vec2u8 from);
+int dungeon_dijkstra_corridor_path(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from, Vec2u16 to);
+// Connects every room with a minimum spanning tree of corridors, carved from a single traversal seeded by all rooms.
+int dungeon_dijkstra_corridor_tree(PathingContext& ctx, DungeonLevel::TerrainMap& map);
+int dungeon_dijkstra_traverse_floor(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from);
+int dungeon_dijkstra_traverse_terrain(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from);
+// Same distances as dungeon_dijkstra_traverse_floor(), computed as a bitboard wavefront and written
+// straight to costs (no predecessor info). Reads the map's floor_mask, which must be current.
+int dungeon_bitwise_traverse_floor(
+    PathingContext& ctx,
+    const DungeonLevel::TerrainMap& map,
+    Vec2u16 from,
+    DungeonLevel::DungeonCostMap& costs );
+Vec2u16 dungeon_dijkstra_nearest_open_drop(PathingContext& ctx, DungeonLevel& l, Vec2u16 from);
+
+int dungeon_dijkstra_repair_floor(
+    PathingContext& ctx,
+    DungeonLevel::TerrainMap& map,
+    DungeonLevel::DungeonCostMap& costs,
+    const Vec2u16* cells, size_t n_cells );
+int dungeon_dijkstra_repair_terrain(
+    PathingContext& ctx,
+    DungeonLevel::TerrainMap& map,
+    DungeonLevel::DungeonCostMap& costs,
+    const Vec2u16* cells, size_t n_cells );
 
 int dungeon_dijkstra_floor_path(
+    PathingContext& ctx,
     DungeonLevel::TerrainMap& map,
-    Vec2u8 from, Vec2u8 to,
-    void* out, void(*on_path_cell)(void*, uint8_t x, uint8_t y) );
+    Vec2u16 from, Vec2u16 to,
+    void* out, void(*on_path_cell)(void*, uint16_t x, uint16_t y) );
 int dungeon_dijkstra_terrain_path(
+    PathingContext& ctx,
     DungeonLevel::TerrainMap& map,
-    Vec2u8 from, Vec2u8 to,
-    void* out, void(*on_path_cell)(void*, uint8_t x, uint8_t y) );
+    Vec2u16 from, Vec2u16 to,
+    void* out, void(*on_path_cell)(void*, uint16_t x, uint16_t y) );
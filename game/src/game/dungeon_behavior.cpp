@@ -5,68 +5,47 @@
 #include "util/math.hpp"
 #include "util/heap.h"
 
-#ifndef BRESENHAM_DEBUG
-#define BRESENHAM_DEBUG 0
-#endif
 
+static constexpr const auto& OFF_DIRECTIONS = DungeonLevel::MOVE_OFFSETS;
 
-static constexpr int8_t OFF_DIRECTIONS[8][2] =
+// lists the set directions of a neighbor mask in increasing order
+static uint8_t expand_directions(uint8_t m, uint8_t valid_dirs[8])
 {
-    { +1,  0 },
-    {  0, -1 },
-    { -1,  0 },
-    {  0, +1 },
-    { +1, +1 },
-    { +1, -1 },
-    { -1, -1 },
-    { -1, +1 },
-};
-
+    uint8_t n = 0;
+    for(; m; m &= (m - 1))
+    {
+        valid_dirs[n++] = static_cast<uint8_t>(__builtin_ctz(m));
+    }
+    return n;
+}
 static uint8_t filter_valid_terrain_directions(
     DungeonLevel::TerrainMap& map,
-    Vec2u8 pos,
+    Vec2u16 pos,
     bool tunneling,
     uint8_t valid_dirs[8])
 {
-    uint8_t n_valid_dirs = 0;
-    uint8_t x, y;
-    for(size_t i = 0; i < 8; i++)
-    {
-        x = pos.x + OFF_DIRECTIONS[i][0];
-        y = pos.y + OFF_DIRECTIONS[i][1];
-        if(map.terrain[y][x].type || (tunneling && map.hardness[y][x] < 0xFF))
-        {
-            valid_dirs[n_valid_dirs] = i;
-            n_valid_dirs++;
-        }
-    }
-    return n_valid_dirs;
+    const uint8_t m = tunneling ?
+        static_cast<uint8_t>(~DungeonLevel::neighborMask(map.solid_mask, pos)) :
+        DungeonLevel::neighborMask(map.floor_mask, pos);
+
+    return expand_directions(m, valid_dirs);
 }
 static uint8_t filter_open_cells(
     DungeonLevel& d,
-    Vec2u8 pos,
+    Vec2u16 pos,
     uint8_t valid_dirs[8] )
 {
-    const uint8_t n = filter_valid_terrain_directions(d.map, pos, false, valid_dirs);
+    const uint8_t m =
+        DungeonLevel::neighborMask(d.map.floor_mask, pos) &
+        ~DungeonLevel::neighborMask(d.occupied, pos);
 
-    uint8_t x, y, r = 0;
-    for(uint8_t i = 0; i < n; i++)
-    {
-        x = pos.x + OFF_DIRECTIONS[valid_dirs[i]][0];
-        y = pos.y + OFF_DIRECTIONS[valid_dirs[i]][1];
-        if(!d.entity_map[y][x])
-        {
-            valid_dirs[r] = valid_dirs[i];
-            r++;
-        }
-    }
-    return r;
+    return expand_directions(m, valid_dirs);
 }
 
 // returns 1 if the entity successfully moved, 0 otherwise
-static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u8 to)
+static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u16 to)
 {
-    Entity*& prev_slot = DungeonLevel::accessGridElem(d.entity_map, e.state.pos);
+    const Vec2u16 from = e.state.pos;
     struct
     {
         uint8_t terrain_updated : 1;
@@ -81,11 +60,12 @@ static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u8 to)
     {
         if(e.config.can_tunnel)
         {
-            uint8_t& h =  DungeonLevel::accessGridElem(d.map.hardness, to);
+            uint8_t& h =  DungeonLevel::accessGridElem(d.map.terrain, to).hardness;
             h = (h > 85 ? h - 85 : 0);
+            d.map.version++;
             if(!h)
             {
-                DungeonLevel::accessGridElem(d.map.terrain, to).type = DungeonLevel::TerrainMap::CELLTYPE_CORRIDOR;
+                d.map.makeCorridor(to);
                 flags.has_entity_moved = 1;
                 flags.floor_updated = 1;
             }
@@ -100,13 +80,12 @@ static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u8 to)
 
     if(flags.has_entity_moved)
     {
-        Entity*& slot = DungeonLevel::accessGridElem(d.entity_map, to);
-        if(slot)   // previous entity
+        if(Entity* x = d.entityAt(to); x)   // previous entity
         {
-            if(slot->config.is_pc)
+            if(x->config.is_pc)
             {
-                slot->state.health -= e.config.attack_damage.roll(d.rroll);
-                if(slot->state.health <= 0)
+                x->state.health -= e.config.attack_damage.roll(d.rng);
+                if(x->state.health <= 0)
                 {
                     e.state.pos = to;
                     d.win_lose = -1;
@@ -118,31 +97,39 @@ static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u8 to)
             }
             else
             {
-                Entity* x = slot;
                 e.state.pos = to;
-                slot = &e;
-                prev_slot = nullptr;
+                d.setEntityAt(to, &e);
+                d.setEntityAt(from, nullptr);
 
+                // the displaced entity steps aside, or swaps places when boxed in
                 uint8_t valid_dirs[8];
                 const uint8_t n_dirs = filter_open_cells(d, x->state.pos, valid_dirs);
-                const uint8_t ri = RANDOM_IN_RANGE(0, n_dirs - 1);
-                x->state.pos.x += OFF_DIRECTIONS[valid_dirs[ri]][0];
-                x->state.pos.y += OFF_DIRECTIONS[valid_dirs[ri]][1];
-                DungeonLevel::accessGridElem(d.entity_map, x->state.pos) = x;
+                if(n_dirs)
+                {
+                    const uint8_t ri = static_cast<uint8_t>(d.rng.bounded(n_dirs));
+                    x->state.pos.x += OFF_DIRECTIONS[valid_dirs[ri]][0];
+                    x->state.pos.y += OFF_DIRECTIONS[valid_dirs[ri]][1];
+                }
+                else
+                {
+                    x->state.pos = from;
+                }
+                d.setEntityAt(x->state.pos, x);
             }
         }
         else
         {
             e.state.pos = to;
-            slot = &e;
-            prev_slot = nullptr;
+            d.setEntityAt(to, &e);
+            d.setEntityAt(from, nullptr);
         }
     }
 
     if(flags.terrain_updated)
     {
         // PRINT_DEBUG("UPDATING TERRAIN %sCOSTS\n", flags.floor_updated ? "(and floor) " : "");
-        d.updateCosts(flags.floor_updated);
+        d.updateCostsAt(to, flags.floor_updated);
+        if(flags.floor_updated) d.regions.addFloorCell(d.map, to);
     }
 
     return flags.has_entity_moved;
@@ -150,93 +137,53 @@ static int handle_entity_move(DungeonLevel& d, Entity& e, Vec2u8 to)
 // returns the result of handle_entity_move()
 static int handle_entity_move_dir(DungeonLevel& d, Entity& e, uint8_t dir_idx)
 {
-    return handle_entity_move( d, e, e.state.pos + Vec2u8{ OFF_DIRECTIONS[dir_idx][0], OFF_DIRECTIONS[dir_idx][1] } );
+    return handle_entity_move( d, e, e.state.pos + Vec2u16{ OFF_DIRECTIONS[dir_idx][0], OFF_DIRECTIONS[dir_idx][1] } );
 }
 
 // returns the result of handle_entity_move_dir() a valid direction was detected, otherwise 0
-static int move_random(DungeonLevel& d, Entity& e, int r)
+static int move_random(DungeonLevel& d, Entity& e, uint32_t r)
 {
     const bool has_tunneling = e.config.can_tunnel;
 
     uint8_t valid_dirs[8];
     uint8_t n_valid_dirs = filter_valid_terrain_directions(d.map, e.state.pos, has_tunneling, valid_dirs);
 
-    return n_valid_dirs ? handle_entity_move_dir(d, e, valid_dirs[(r ? r : rand()) % n_valid_dirs]) : 0;
+    return n_valid_dirs ? handle_entity_move_dir(d, e, valid_dirs[r ? r % n_valid_dirs : d.rng.bounded(n_valid_dirs)]) : 0;
 }
 
-static int bresenham_check_los(DungeonLevel& d, Entity& e, Vec2u8& trav_cell)
+// first cell of the Bresenham line from the entity to the PC
+static Vec2u16 bresenham_first_step(const DungeonLevel& d, const Entity& e)
 {
-    #define ENTITY e.state.pos
-    #define PLAYER d.pc.state.pos
-
-#if BRESENHAM_DEBUG
-    PRINT_DEBUG("BRESENHAM: calculating from (%d, %d) to (%d, %d)\n", ENTITY.x, ENTITY.y, PLAYER.x, PLAYER.y);
-#endif
-
-    const int32_t dx = abs((int32_t)PLAYER.x - (int32_t)ENTITY.x);
-    const int32_t dy = -abs((int32_t)PLAYER.y - (int32_t)ENTITY.y);
-    const int32_t sx = ENTITY.x < PLAYER.x ? 1 : -1;
-    const int32_t sy = ENTITY.y < PLAYER.y ? 1 : -1;
-    int32_t err = dx + dy;
-
-    int32_t x = ENTITY.x;
-    int32_t y = ENTITY.y;
-    for(int i = 0; !(x == PLAYER.x && y == PLAYER.y); i++)
-    {
-        const int32_t err2 = err * 2;
-        if(err2 >= dy)
-        {
-            err = err + dy;
-            x += sx;
-        }
-        if(err2 <= dx)
-        {
-            err = err + dx;
-            y += sy;
-        }
-
-    #if BRESENHAM_DEBUG
-        PRINT_DEBUG("BRESENHAM ITERATION %d : (%d, %d) -- terrain: %d\n", i, x, y, d->map.terrain[y][x].type);
-    #endif
+    const Vec2u16 a = e.state.pos, b = d.pc.state.pos;
 
-        if(!i)  // set on first iteration
-        {
-            trav_cell.x = (uint8_t)x;
-            trav_cell.y = (uint8_t)y;
-        }
-        if(d.map.terrain[y][x].isRock())  // exit on rock intersection
-        {
-            return i + 1;
-        }
-    }
-
-    return 0;
+    const int32_t dx = abs((int32_t)b.x - (int32_t)a.x);
+    const int32_t dy = -abs((int32_t)b.y - (int32_t)a.y);
+    const int32_t err2 = (dx + dy) * 2;
 
-    #undef ENTITY
-    #undef PLAYER
-}
+    Vec2u16 step = a;
+    if(err2 >= dy) step.x += (a.x < b.x ? 1 : -1);
+    if(err2 <= dx) step.y += (a.y < b.y ? 1 : -1);
 
-static void pathing_export_vec2u8(void* v, uint8_t x, uint8_t y)
-{
-    reinterpret_cast<Vec2u8*>(v)->assign(x, y);
+    return step;
 }
 
 
 
 
-int DungeonLevel::handlePCMove(Vec2u8 to, bool is_goto)
+int DungeonLevel::handlePCMove(Vec2u16 to, bool is_goto)
 {
     if(to == this->pc.state.pos) return false;
 
-    Entity*& prev_slot = DungeonLevel::accessGridElem(this->entity_map, this->pc.state.pos);
+    const Vec2u16 from = this->pc.state.pos;
     bool has_moved = false;
 
     if(DungeonLevel::accessGridElem(this->map.terrain, to).isRock())
     {
         if(is_goto)
         {
-            DungeonLevel::accessGridElem(this->map.hardness, to) = 0;
-            DungeonLevel::accessGridElem(this->map.terrain, to).type = DungeonLevel::TerrainMap::CELLTYPE_CORRIDOR;
+            this->map.makeCorridor(to);
+            this->map.version++;
+            this->regions.addFloorCell(this->map, to);
             has_moved = true;
         }
     }
@@ -247,38 +194,37 @@ int DungeonLevel::handlePCMove(Vec2u8 to, bool is_goto)
 
     if(has_moved)
     {
-        Entity*& slot = DungeonLevel::accessGridElem(this->entity_map, to);
-        if(slot)   // previous entity
+        if(Entity* x = this->entityAt(to); x)   // previous entity
         {
             int32_t a = this->rollPCDamage();
-            slot->state.health -= a;
+            x->state.health -= a;
 
-            if(slot->state.health <= 0)
+            if(x->state.health <= 0)
             {
-                NC_PRINT("Dealt %d damage to [%s (dead)]", a, slot->config.name.data());
+                NC_PRINT("Dealt %d damage to [%s (dead)]", a, x->config.name.data());
 
                 this->npcs_remaining--;
-                if(slot->config.is_boss) this->win_lose = 1;
+                if(x->config.is_boss) this->win_lose = 1;
 
-                slot = &this->pc;
+                this->setEntityAt(to, &this->pc);
+                this->setEntityAt(from, nullptr);
                 this->pc.state.pos = to;
-                prev_slot = nullptr;
             }
             else
             {
-                NC_PRINT("Dealt %d damage to [%s (H: %d health)]", a, slot->config.name.data(), slot->state.health);
+                NC_PRINT("Dealt %d damage to [%s (H: %d health)]", a, x->config.name.data(), x->state.health);
             }
         }
         else
         {
-            slot = &this->pc;
+            this->setEntityAt(to, &this->pc);
+            this->setEntityAt(from, nullptr);
             this->pc.state.pos = to;
-            prev_slot = nullptr;
         }
 
         // PRINT_DEBUG("UPDATING TERRAIN %sCOSTS\n", flags.floor_updated ? "(and floor) " : "");
         this->copyVisCells();
-        this->updateCosts(true);
+        this->invalidateCosts();
     }
 
     return has_moved;
@@ -286,6 +232,13 @@ int DungeonLevel::handlePCMove(Vec2u8 to, bool is_goto)
 
 // returns 0 if no movement occurred, otherwise returns the result of move_random() or handle_entity_move()
 int DungeonLevel::iterateNPC(Entity& e)
+{
+    NPCPlan plan;
+    this->planNPC(e, this->rng(), false, plan);
+    return this->applyNPC(e, plan);
+}
+
+void DungeonLevel::planNPC(Entity& e, uint32_t r, bool shared_only, NPCPlan& plan)
 {
     // FileDebug::get()
     //     << "\tSM : " << (int)e.config.is_smart
@@ -299,7 +252,10 @@ int DungeonLevel::iterateNPC(Entity& e)
         uint8_t computed_can_see_pc : 1;
     }
     flags;
-    Vec2u8 move_pos;
+    Vec2u16& move_pos = plan.to;
+    plan.from = e.state.pos;
+    plan.r = r;
+    plan.type = NPCPlan::NONE;
     // vec2u8_copy(&move_pos, &e->pos);    // ensure save no-op so we don't use garbage
 
 #define GET_MIN_COST_NEIGHBOR(vout, map) \
@@ -307,8 +263,8 @@ int DungeonLevel::iterateNPC(Entity& e)
     int32_t min_cost = map[vout.y][vout.x]; \
     for(uint8_t i = 1; i < 8; i++) \
     { \
-        const uint8_t x = e.state.pos.x + OFF_DIRECTIONS[i][0]; \
-        const uint8_t y = e.state.pos.y + OFF_DIRECTIONS[i][1]; \
+        const uint16_t x = e.state.pos.x + OFF_DIRECTIONS[i][0]; \
+        const uint16_t y = e.state.pos.y + OFF_DIRECTIONS[i][1]; \
         const int32_t c = map[y][x]; \
         if(c < min_cost) \
         { \
@@ -317,13 +273,25 @@ int DungeonLevel::iterateNPC(Entity& e)
             min_cost = c; \
         } \
     }
+#define GET_FLOW_NEIGHBOR(vout, dirs) \
+    { \
+        const uint32_t d = dirs.get(e.state.pos.x, e.state.pos.y); \
+        vout.assign(e.state.pos.x + OFF_DIRECTIONS[d][0], e.state.pos.y + OFF_DIRECTIONS[d][1]); \
+    }
+// shared state would have to be (re)built first
+#define DEFER_PLAN \
+    { \
+        plan.type = NPCPlan::DEFER; \
+        return; \
+    }
 
     if(e.config.is_smart && !e.config.is_tele)  // check LOS if can remember for the future and not telepathic
     {
-        if(e.state.target_pos != Vec2u8{ 0, 0 } && e.state.pos == e.state.target_pos) e.state.target_pos.assign(0, 0);
+        if(e.state.target_pos != Vec2u16{ 0, 0 } && e.state.pos == e.state.target_pos) e.state.target_pos.assign(0, 0);
 
-        if((flags.can_see_pc = !bresenham_check_los(*this, e, move_pos)))    // set flag and entity state
+        if((flags.can_see_pc = this->inPCView(e.state.pos)))    // set flag and entity state
         {
+            move_pos = bresenham_first_step(*this, e);
             // PRINT_DEBUG("(%#x) : Monster can see PC - updating known location to (%d, %d).\n", e->md.stats, d->pc->pos.x, d->pc->pos.y);
             e.state.target_pos = this->pc.state.pos;    // update known pc location
         }
@@ -338,11 +306,11 @@ int DungeonLevel::iterateNPC(Entity& e)
     // FileDebug::get() << "\tflags.can_see_pc : " << (int)flags.can_see_pc
     //     << ", flags.computed_can_see_pc : " << (int)flags.computed_can_see_pc << '\n';
 
-    const int r = rand();
     if(e.config.is_erratic && (r & 0x1))
     {
         // PRINT_DEBUG("(%#x) : Moving erraticly.\n", e->md.stats);
-        return move_random(*this, e, (r >> 1));
+        plan.type = NPCPlan::RANDOM;
+        return;
     }
     else
     {
@@ -353,28 +321,39 @@ int DungeonLevel::iterateNPC(Entity& e)
                 if(e.config.can_tunnel)
                 {
                     // PRINT_DEBUG("(%#x) : Telepathically moving towards PC using the optimal TUNNELING path.\n", e->md.stats);
+                #if DUNGEON_USE_FLOW_FIELDS
+                    if(shared_only && (this->stale_costs || (this->stale_dirs & 0x2))) DEFER_PLAN
+                    GET_FLOW_NEIGHBOR(move_pos, this->getCostDirections(true))
+                #else
+                    if(shared_only && this->stale_costs) DEFER_PLAN
+                    this->refreshCosts();
                     GET_MIN_COST_NEIGHBOR(move_pos, this->terrain_costs)
+                #endif
                     // return handle_entity_move(d, e, move_pos.x, move_pos.y); (END)
                 }
                 else
                 {
                     // PRINT_DEBUG("(%#x) : Telepathically moving towards PC using the optimal FLOOR path\n", e->md.stats);
+                #if DUNGEON_USE_FLOW_FIELDS
+                    if(shared_only && (this->stale_costs || (this->stale_dirs & 0x1))) DEFER_PLAN
+                    GET_FLOW_NEIGHBOR(move_pos, this->getCostDirections(false))
+                #else
+                    if(shared_only && this->stale_costs) DEFER_PLAN
+                    this->refreshCosts();
                     GET_MIN_COST_NEIGHBOR(move_pos, this->tunnel_costs)
+                #endif
                     // return handle_entity_move(d, e, move_pos.x, move_pos.y); (END)
                 }
             }
             else
             {
                 // PRINT_DEBUG("(%#x) : Telpathically moving towards the PC using the DIRECT path\n", e->md.stats);
-                if(!flags.computed_can_see_pc)
-                {
-                    bresenham_check_los(*this, e, move_pos);   // get the next cell directly toward the PC
-                }
+                move_pos = bresenham_first_step(*this, e);   // get the next cell directly toward the PC
 
                 if(!e.config.can_tunnel && this->map.terrain[move_pos.y][move_pos.x].isRock())
                 {
                     // PRINT_DEBUG("(%#x) : Not moving since monster is NON-TUNNELING.\n", e->md.stats);
-                    return 0;
+                    return;
                 }
 
                 // return handle_entity_move(d, e, move_pos.x, move_pos.y); (END)
@@ -382,35 +361,56 @@ int DungeonLevel::iterateNPC(Entity& e)
         }
         else
         {
-            if(!flags.computed_can_see_pc) flags.can_see_pc = !bresenham_check_los(*this, e, move_pos);
+            if(!flags.computed_can_see_pc) flags.can_see_pc = this->inPCView(e.state.pos);
 
             if(flags.can_see_pc)
             {
+                move_pos = bresenham_first_step(*this, e);
                 // PRINT_DEBUG("(%#x) : Moving directly towards the PC (LINE OF SIGHT).\n", e->md.stats);
                 // return handle_entity_move(d, e, move_pos.x, move_pos.y); (END)
             }
             else
             {
-                if(e.config.is_smart && e.state.target_pos != Vec2u8{ 0, 0 })
+                if(e.config.is_smart && e.state.target_pos != Vec2u16{ 0, 0 })
                 {
                     if(e.config.can_tunnel)
                     {
                         // PRINT_DEBUG("(%#x) : Moving towards the PC's last known location (%d, %d) using the optimal TUNNELING path.\n",
                         //     e->md.stats, e->md.pc_rem_pos.x, e->md.pc_rem_pos.y );
-                        dungeon_dijkstra_terrain_path(this->map, e.state.pos, e.state.target_pos, &move_pos, pathing_export_vec2u8);
+                        const DungeonCostMap* field = shared_only ?
+                            this->findTargetCosts(e.state.target_pos, true) :
+                            &this->getTargetCosts(e.state.target_pos, true);
+                        if(!field) DEFER_PLAN
+                        GET_MIN_COST_NEIGHBOR(move_pos, (*field))
+                        if(min_cost == std::numeric_limits<int32_t>::max()) return;
                     }
                     else
                     {
                         // PRINT_DEBUG("(%#x) : Moving towards the PC's last known location (%d, %d) using the optimal FLOOR path.\n",
                         //     e->md.stats, e->md.pc_rem_pos.x, e->md.pc_rem_pos.y );
-                        dungeon_dijkstra_floor_path(this->map,  e.state.pos, e.state.target_pos, &move_pos, pathing_export_vec2u8);
+                        if(static_cast<size_t>(this->width()) * this->height() >= DUNGEON_REGION_PATHING_MIN_CELLS)
+                        {
+                            if(shared_only && !this->regions.isCurrent(this->map)) DEFER_PLAN
+                            if(!(shared_only ?
+                                this->regions.firstStep(e.state.pos, e.state.target_pos, move_pos) :
+                                this->regions.nextStep(this->map, e.state.pos, e.state.target_pos, move_pos)) ) return;
+                        }
+                        else
+                        {
+                            const DungeonCostMap* field = shared_only ?
+                                this->findTargetCosts(e.state.target_pos, false) :
+                                &this->getTargetCosts(e.state.target_pos, false);
+                            if(!field) DEFER_PLAN
+                            GET_MIN_COST_NEIGHBOR(move_pos, (*field))
+                            if(min_cost == std::numeric_limits<int32_t>::max()) return;
+                        }
                     }
                 }
                 else
                 {
                     // PRINT_DEBUG("(%#x) : Wandering since no obvious moves are possible.\n", e->md.stats);
                     // return move_random(d, e, r);
-                    return 0;
+                    return;
                 }
             }
         }
@@ -419,9 +419,68 @@ int DungeonLevel::iterateNPC(Entity& e)
     // FileDebug::get() << "\tNPC attempting to move to : (" << move_pos.x << ", " << move_pos.y << ")\n";
 
     // PRINT_DEBUG("MOVING TO: (%d, %d)\n", move_pos.x, move_pos.y);
-    return handle_entity_move(*this, e, move_pos);
+    plan.type = NPCPlan::MOVE;
 
 #undef GET_MIN_COST_NEIGHBOR
+#undef GET_FLOW_NEIGHBOR
+#undef DEFER_PLAN
+}
+
+int DungeonLevel::applyNPC(Entity& e, const NPCPlan& plan)
+{
+    switch(plan.type)
+    {
+        case NPCPlan::MOVE :    return handle_entity_move(*this, e, plan.to);
+        case NPCPlan::RANDOM :  return move_random(*this, e, (plan.r >> 1));
+        default :               return 0;
+    }
+}
+
+void DungeonLevel::iterateNPCs(Entity* const* npcs, size_t n, ThreadPool& pool)
+{
+    // 1. BRING SHARED FIELDS UP TO DATE
+    std::vector<NPCPlan> plans(n);
+    bool needs_regions = false;
+    for(size_t i = 0; i < n; i++)
+    {
+        const Entity& e = *npcs[i];
+
+        if(e.config.is_tele && e.config.is_smart)
+        {
+        #if DUNGEON_USE_FLOW_FIELDS
+            this->getCostDirections(e.config.can_tunnel);
+        #else
+            this->refreshCosts();
+        #endif
+        }
+        needs_regions |= (e.config.is_smart && !e.config.is_tele && !e.config.can_tunnel);
+    }
+    if(needs_regions && static_cast<size_t>(this->width()) * this->height() >= DUNGEON_REGION_PATHING_MIN_CELLS)
+    {
+        this->regions.update(this->map);
+    }
+
+    // 2. PLAN CONCURRENTLY -- THE LEVEL IS READ ONLY UNTIL EVERY PLAN IS IN
+    // each NPC's roll comes from its own stream of the batch, independent of thread timing
+    const uint64_t batch_seed = this->rng.next64();
+    pool.parallelFor(n, [&](size_t i)
+    {
+        this->planNPC(*npcs[i], Pcg32{ batch_seed, i }(), true, plans[i]);
+    });
+
+    // 3. APPLY IN QUEUE ORDER
+    for(size_t i = 0; i < n && !this->win_lose; i++)
+    {
+        Entity& e = *npcs[i];
+        NPCPlan& plan = plans[i];
+
+        // displaced since the plan was made, or the plan needed a field that wasn't cached
+        if(plan.type == NPCPlan::DEFER || e.state.pos != plan.from)
+        {
+            this->planNPC(e, plan.r, false, plan);
+        }
+        this->applyNPC(e, plan);
+    }
 }
 
 
@@ -476,11 +535,11 @@ int32_t DungeonLevel::rollPCDamage()
         }
         else
         {
-            ret += i->attack_damage.roll(this->rroll);
+            ret += i->attack_damage.roll(this->rng);
         }
     }
 
-    return no_equip ? this->pc.config.attack_damage.roll(this->rroll) : ret;
+    return no_equip ? this->pc.config.attack_damage.roll(this->rng) : ret;
 }
 
 int32_t DungeonLevel::getPCSpeed()
@@ -508,13 +567,11 @@ void DungeonLevel::handleItemDrop(Item& i)
 {
     if(!DungeonLevel::accessGridElem(this->item_map, this->pc.state.pos))
     {
-        DungeonLevel::accessGridElem(this->item_map, this->pc.state.pos) = &i;
+        this->placeItem(this->pc.state.pos, &i);
     }
     else
     {
-        DungeonLevel::accessGridElem(
-            this->item_map,
-            dungeon_dijkstra_nearest_open_drop(*this, this->pc.state.pos) ) = &i;
+        this->placeItem(dungeon_dijkstra_nearest_open_drop(this->pathing, *this, this->pc.state.pos), &i);
     }
 }
 
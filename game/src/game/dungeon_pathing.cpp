@@ -1,418 +1,990 @@
 #include "dungeon.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstdint>
+#include <utility>
 #include <limits>
+#include <vector>
+#include <tuple>
+
+#include "util/bucket_queue.hpp"
 
 
 static int32_t cell_path_cost_cmp(const void* k, const void* w)
 {
     return reinterpret_cast<const CellPathNode*>(k)->cost - reinterpret_cast<const CellPathNode*>(w)->cost;
 }
+static int32_t cell_path_priority_cmp(const void* k, const void* w)
+{
+    return reinterpret_cast<const CellPathNode*>(k)->priority - reinterpret_cast<const CellPathNode*>(w)->priority;
+}
 
-int init_pathing_buffer(PathFindingBuffer buff)
+// Lower bound on the remaining path cost. Diagonal steps cost the same as cardinal
+// ones here, so the octile distance reduces to chebyshev distance.
+static inline int32_t path_heuristic(Vec2u16 a, Vec2u16 b, int use_diag, int32_t min_weight)
 {
-    for(size_t y = 0; y < DUNGEON_Y_DIM; y++)
+    const int32_t
+        dx = std::abs(static_cast<int32_t>(a.x) - static_cast<int32_t>(b.x)),
+        dy = std::abs(static_cast<int32_t>(a.y) - static_cast<int32_t>(b.y));
+
+    return min_weight * (use_diag ? std::max(dx, dy) : (dx + dy));
+}
+
+int init_pathing_buffer(PathFindingBuffer& buff)
+{
+    for(size_t y = 0; y < buff.height(); y++)
     {
-        for(size_t x = 0; x < DUNGEON_X_DIM; x++)
+        for(size_t x = 0; x < buff.width(); x++)
         {
             buff[y][x].pos.x = x;
             buff[y][x].pos.y = y;
+            buff[y][x].visit = 0;
         }
     }
     return 0;
 }
 
-int dungeon_dijkstra_single_path(
-    PathFindingBuffer buff,
-    const DungeonLevel::TerrainMap& map,
-    void* out,
-    Vec2u8 from,
-    Vec2u8 to,
-    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    void(*on_cell_path)(void*, uint8_t x, uint8_t y),
-    int use_diag )
+PathingContext::PathingContext()
 {
-    CellPathNode *p;
-    Heap h;
-    uint8_t x, y;
+    heap_arena_init(&this->heap_nodes, 0);
+    this->resize(DUNGEON_X_DIM, DUNGEON_Y_DIM);
+}
+PathingContext::~PathingContext()
+{
+    heap_arena_delete(&this->heap_nodes);
+}
+
+void PathingContext::resize(size_t w, size_t h)
+{
+    if(this->buff.width() == w && this->buff.height() == h) return;
 
-    Vec2u8 iter8;
+    this->buff.resize(w, h);
+    init_pathing_buffer(this->buff);
+    this->visit_stamp = 0;
 
-// RESET ALL WEIGHTS TO MAX
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
+    if(this->heap_nodes.capacity < w * h)
     {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            buff[y][x].cost = std::numeric_limits<int32_t>::max();
-        }
+        heap_arena_delete(&this->heap_nodes);
+        heap_arena_init(&this->heap_nodes, static_cast<uint32_t>(w * h));
     }
-// INIT SRC NODE
-    buff[from.y][from.x].cost = 0;
-// CREATE HEAP
-    heap_init(&h, cell_path_cost_cmp, NULL);
-// CREATE HEAP NODES
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
+
+    this->bfs_seen.resize(w, h);
+    this->bfs_front[0].resize(w, h);
+    this->bfs_front[1].resize(w, h);
+    this->bfs_grow.resize(w, 1);
+}
+
+void PathingContext::release()
+{
+    this->buff = PathFindingBuffer{};
+    this->queue = BucketQueue{};
+    this->seeds = {};
+    this->bfs_seen = BitRows{};
+    this->bfs_front[0] = BitRows{};
+    this->bfs_front[1] = BitRows{};
+    this->bfs_grow = BitRows{};
+
+    heap_arena_delete(&this->heap_nodes);
+    heap_arena_init(&this->heap_nodes, 0);
+}
+
+size_t PathingContext::bytes() const
+{
+    size_t b = this->buff.bytes();   // heap arena nodes are opaque here and not counted
+    for(const BitRows* r : { &this->bfs_seen, &this->bfs_front[0], &this->bfs_front[1], &this->bfs_grow })
     {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            if(should_use_cell(map, x, y))
-            {
-                buff[y][x].hn = heap_insert(&h, buff[y] + x);
-            }
-            else
-            {
-                buff[y][x].hn = NULL;
-            }
-        }
+        b += r->rowWords() * r->rows() * sizeof(uint64_t);
     }
-// ALGO
+    return b;
+}
+
+PathingContext& PathingContext::local()
+{
+    static thread_local PathingContext ctx;
+    return ctx;
+}
+
+// Cells are only valid for the current search if their visit stamp matches,
+// which avoids having to touch every cell before each search.
+static uint32_t next_visit_stamp(PathingContext& ctx)
+{
+    if(!++ctx.visit_stamp)
+    {
+        init_pathing_buffer(ctx.buff);
+        ctx.visit_stamp = 1;
+    }
+    return ctx.visit_stamp;
+}
+
+// Invokes f(x, y) for each neighbor of p -- cardinal directions first, in a fixed order.
+template<bool Diag, typename F>
+static inline void for_each_neighbor(Vec2u16 p, F&& f)
+{
+    f(p.x, p.y - 1);
+    f(p.x - 1, p.y);
+    f(p.x + 1, p.y);
+    f(p.x, p.y + 1);
+    if constexpr(Diag)
+    {
+        f(p.x - 1, p.y - 1);
+        f(p.x - 1, p.y + 1);
+        f(p.x + 1, p.y - 1);
+        f(p.x + 1, p.y + 1);
+    }
+}
+
+
+
+/* Templated pathing core. Cell policies are plain callables taking (x, y) so
+ * that the specialized wrappers below can pass lambdas which inline into the
+ * relaxation loops, while the C-style entry points pass adapted function
+ * pointers through the same code. */
+
+template<bool Diag, typename UseF, typename WeightF, typename PathF>
+static int single_path_core(
+    PathingContext& ctx,
+    Vec2u16 from,
+    Vec2u16 to,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight,
+    PathF&& on_cell_path,
+    int32_t min_weight )
+{
+    CellPathNode *p;
+    Heap h;
+
+    Vec2u16 iter8;
+
+    PathFindingBuffer& buff = ctx.buff;
+    const uint32_t stamp = next_visit_stamp(ctx);
+
+    if(!should_use_cell(from.x, from.y)) return -1;
+// CREATE HEAP
+    heap_init_arena(&h, cell_path_priority_cmp, NULL, &ctx.heap_nodes);
+// INIT SRC NODE -- all other cells are inserted once they are reached
+    p = &buff[from.y][from.x];
+    p->visit = stamp;
+    p->cost = 0;
+    p->priority = path_heuristic(from, to, Diag, min_weight);
+    p->hn = heap_insert(&h, p);
+// ALGO -- the heuristic is consistent, so popped cells are never reopened
     while((p = static_cast<CellPathNode*>(heap_remove_min(&h))))
     {
         p->hn = NULL;   // node was deleted from the heap
+        ctx.expanded_nodes++;
 
         if(p->pos == to)
         {
         // EXPORT PATH
             for(iter8 = to; iter8 != from; iter8 = p->from)
             {
-                on_cell_path(out, iter8.x, iter8.y);
+                on_cell_path(iter8.x, iter8.y);
                 p = &buff[iter8.y][iter8.x];
             }
             heap_delete(&h);
             return 0;
         }
 
-        const int32_t p_cost = p->cost + cell_weight(map, p->pos.x, p->pos.y);
+        const int32_t p_cost = p->cost + cell_weight(p->pos.x, p->pos.y);
 
-        // CHECK CARDINAL DIRECTIONS
-    #define CHECK_NEIGHBOR(x, y) \
-        if( (buff[(y)][(x)].hn) && (buff[(y)][(x)].cost > p_cost) ) \
-        { \
-            buff[(y)][(x)].cost = p_cost; \
-            buff[(y)][(x)].from = p->pos; \
-            heap_decrease_key_no_replace(&h, buff[(y)][(x)].hn); \
-        }
-
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y - 1)
-        CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y + 1)
-        if(use_diag)
-        {
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y + 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y + 1)
-        }
-    #undef CHECK_NEIGHBOR
+        for_each_neighbor<Diag>(p->pos,
+            [&](uint16_t x, uint16_t y)
+            {
+                CellPathNode& n = buff[y][x];
+                if(n.visit == stamp)
+                {
+                    if(n.hn && n.cost > p_cost)
+                    {
+                        n.priority -= n.cost - p_cost;
+                        n.cost = p_cost;
+                        n.from = p->pos;
+                        heap_decrease_key_no_replace(&h, n.hn);
+                    }
+                }
+                else if(should_use_cell(x, y))
+                {
+                    n.visit = stamp;
+                    n.cost = p_cost;
+                    n.priority = p_cost + path_heuristic(n.pos, to, Diag, min_weight);
+                    n.from = p->pos;
+                    n.hn = heap_insert(&h, &n);
+                }
+            } );
     }
 
+    heap_delete(&h);
     return -1;
 }
 
-int dungeon_dijkstra_traverse_grid(
-    PathFindingBuffer buff,
-    const DungeonLevel::TerrainMap& map,
-    Vec2u8 from,
-    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint8_t x, uint8_t y),
-    int use_diag )
+template<bool Diag, typename UseF, typename WeightF>
+static int dial_traverse_core(
+    PathingContext& ctx,
+    Vec2u16 from,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight,
+    int32_t max_weight )
 {
-    CellPathNode *p;
-    Heap h;
-    uint8_t x, y;
+    PathFindingBuffer& buff = ctx.buff;
+    BucketQueue& q = ctx.queue;
+    const uint32_t w = static_cast<uint32_t>(buff.width());
+    uint32_t i;
 
 // RESET ALL WEIGHTS TO MAX
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
+    for(i = 0; i < buff.size(); i++)
     {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            buff[y][x].cost = std::numeric_limits<int32_t>::max();
-        }
+        buff.data()[i].cost = std::numeric_limits<int32_t>::max();
     }
 // INIT SRC NODE
     buff[from.y][from.x].cost = 0;
-// CREATE HEAP
-    heap_init(&h, cell_path_cost_cmp, NULL);
-// CREATE HEAP NODES
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
+    if(!should_use_cell(from.x, from.y)) return 0;
+// CREATE QUEUE -- cells are only enqueued once they have been reached
+    q.reset(buff.size(), static_cast<uint32_t>(max_weight));
+    q.push(from.y * w + from.x, 0);
+// ALGO
+    while((i = q.pop()) != BucketQueue::NIL)
     {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            if(should_use_cell(map, x, y))
-            {
-                buff[y][x].hn = heap_insert(&h, buff[y] + x);
-            }
-            else
+        const CellPathNode* p = &buff[i / w][i % w];
+
+        // a popped cell has its final cost, so relaxing it again can never succeed
+        for_each_neighbor<Diag>(p->pos,
+            [&](uint16_t x, uint16_t y)
             {
-                buff[y][x].hn = NULL;
-            }
-        }
+                if(!should_use_cell(x, y)) return;
+
+                CellPathNode& n = buff[y][x];
+                const int32_t p_cost = p->cost + cell_weight(x, y);
+                if(n.cost > p_cost)
+                {
+                    if(n.cost == std::numeric_limits<int32_t>::max()) q.push(y * w + x, p_cost);
+                    else q.decrease(y * w + x, p_cost);
+                    n.cost = p_cost;
+                    n.from = p->pos;
+                }
+            } );
     }
+
+    return 0;
+}
+
+template<bool Diag, typename UseF, typename WeightF>
+static int heap_traverse_core(
+    PathingContext& ctx,
+    Vec2u16 from,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight )
+{
+    CellPathNode *p;
+    Heap h;
+
+    PathFindingBuffer& buff = ctx.buff;
+    const uint32_t stamp = next_visit_stamp(ctx);
+
+// RESET ALL WEIGHTS TO MAX -- the full cost map is the output of the traversal
+    for(size_t i = 0; i < buff.size(); i++)
+    {
+        buff.data()[i].cost = std::numeric_limits<int32_t>::max();
+    }
+// INIT SRC NODE
+    buff[from.y][from.x].cost = 0;
+    if(!should_use_cell(from.x, from.y)) return 0;
+// CREATE HEAP
+    heap_init_arena(&h, cell_path_cost_cmp, NULL, &ctx.heap_nodes);
+    p = &buff[from.y][from.x];
+    p->visit = stamp;
+    p->hn = heap_insert(&h, p);
 // ALGO
     while((p = static_cast<CellPathNode*>(heap_remove_min(&h))))
     {
         p->hn = NULL;   // node was deleted from the heap
 
-        int32_t p_cost;
-
-        // CHECK CARDINAL DIRECTIONS
-    #define CHECK_NEIGHBOR(x, y) \
-        p_cost = p->cost + cell_weight(map, x, y); \
-        if( (buff[(y)][(x)].hn) && (buff[(y)][(x)].cost > p_cost) ) \
-        { \
-            buff[(y)][(x)].cost = p_cost; \
-            buff[(y)][(x)].from = p->pos; \
-            heap_decrease_key_no_replace(&h, buff[(y)][(x)].hn); \
-        }
-
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y - 1)
-        CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y + 1)
-        if(use_diag)
-        {
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y + 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y + 1)
-        }
-    #undef CHECK_NEIGHBOR
+        for_each_neighbor<Diag>(p->pos,
+            [&](uint16_t x, uint16_t y)
+            {
+                CellPathNode& n = buff[y][x];
+                if(n.visit == stamp)
+                {
+                    const int32_t p_cost = p->cost + cell_weight(x, y);
+                    if(n.hn && n.cost > p_cost)
+                    {
+                        n.cost = p_cost;
+                        n.from = p->pos;
+                        heap_decrease_key_no_replace(&h, n.hn);
+                    }
+                }
+                else if(should_use_cell(x, y))
+                {
+                    n.visit = stamp;
+                    n.cost = p->cost + cell_weight(x, y);
+                    n.from = p->pos;
+                    n.hn = heap_insert(&h, &n);
+                }
+            } );
     }
 
     heap_delete(&h);
     return 0;
 }
 
-Vec2u8 dungeon_dijkstra_find_nearest(
-    PathFindingBuffer buff,
-    const DungeonLevel& l,
-    Vec2u8 from,
-    int(*should_use_cell)(const DungeonLevel&, uint8_t x, uint8_t y),
-    int32_t(*cell_weight)(const DungeonLevel&, uint8_t x, uint8_t y),
-    bool(*does_qualify)(const DungeonLevel&, uint8_t x, uint8_t y),
-    int use_diag )
+// Seeds every cell yielded by for_each_seed(emit) -- emit(x, y, group) -- at cost 0. Each reached cell
+// ends up with the cost from its nearest seed and that seed's group in CellPathNode::source.
+template<bool Diag, typename SeedF, typename UseF, typename WeightF>
+static int multi_traverse_core(
+    PathingContext& ctx,
+    SeedF&& for_each_seed,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight )
 {
     CellPathNode *p;
     Heap h;
-    uint8_t x, y;
+
+    PathFindingBuffer& buff = ctx.buff;
+    const uint32_t stamp = next_visit_stamp(ctx);
 
 // RESET ALL WEIGHTS TO MAX
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
+    for(size_t i = 0; i < buff.size(); i++)
     {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
-        {
-            buff[y][x].cost = std::numeric_limits<int32_t>::max();
-        }
+        buff.data()[i].cost = std::numeric_limits<int32_t>::max();
     }
-// INIT SRC NODE
-    buff[from.y][from.x].cost = 0;
-// CREATE HEAP
-    heap_init(&h, cell_path_cost_cmp, NULL);
-// CREATE HEAP NODES
-    for(y = 0; y < DUNGEON_Y_DIM; y++)
-    {
-        for(x = 0; x < DUNGEON_X_DIM; x++)
+// CREATE HEAP, INIT SRC NODES
+    heap_init_arena(&h, cell_path_cost_cmp, NULL, &ctx.heap_nodes);
+    for_each_seed(
+        [&](uint16_t x, uint16_t y, uint16_t group)
         {
-            if(should_use_cell(l, x, y))
-            {
-                buff[y][x].hn = heap_insert(&h, buff[y] + x);
-            }
-            else
+            CellPathNode& n = buff[y][x];
+            if(n.visit == stamp || !should_use_cell(x, y)) return;
+
+            n.visit = stamp;
+            n.cost = 0;
+            n.from = n.pos;
+            n.source = group;
+            n.hn = heap_insert(&h, &n);
+        } );
+// ALGO
+    while((p = static_cast<CellPathNode*>(heap_remove_min(&h))))
+    {
+        p->hn = NULL;   // node was deleted from the heap
+
+        for_each_neighbor<Diag>(p->pos,
+            [&](uint16_t x, uint16_t y)
             {
-                buff[y][x].hn = NULL;
-            }
-        }
+                CellPathNode& n = buff[y][x];
+                if(n.visit == stamp)
+                {
+                    const int32_t p_cost = p->cost + cell_weight(x, y);
+                    if(n.hn && n.cost > p_cost)
+                    {
+                        n.cost = p_cost;
+                        n.from = p->pos;
+                        n.source = p->source;
+                        heap_decrease_key_no_replace(&h, n.hn);
+                    }
+                }
+                else if(should_use_cell(x, y))
+                {
+                    n.visit = stamp;
+                    n.cost = p->cost + cell_weight(x, y);
+                    n.from = p->pos;
+                    n.source = p->source;
+                    n.hn = heap_insert(&h, &n);
+                }
+            } );
+    }
+
+    heap_delete(&h);
+    return 0;
+}
+
+template<bool Diag, typename UseF, typename WeightF>
+static int traverse_core(
+    PathingContext& ctx,
+    Vec2u16 from,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight,
+    int32_t max_weight )
+{
+    if(max_weight > 0 && max_weight <= DUNGEON_PATHING_BUCKET_MAX_WEIGHT)
+    {
+        return dial_traverse_core<Diag>(ctx, from, should_use_cell, cell_weight, max_weight);
     }
+    return heap_traverse_core<Diag>(ctx, from, should_use_cell, cell_weight);
+}
+
+template<bool Diag, typename UseF, typename WeightF, typename QualifyF>
+static Vec2u16 find_nearest_core(
+    PathingContext& ctx,
+    Vec2u16 from,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight,
+    QualifyF&& does_qualify )
+{
+    CellPathNode *p;
+    Heap h;
+
+    PathFindingBuffer& buff = ctx.buff;
+    const uint32_t stamp = next_visit_stamp(ctx);
+
+    if(!should_use_cell(from.x, from.y)) return Vec2u16{ 0, 0 };
+// CREATE HEAP
+    heap_init_arena(&h, cell_path_cost_cmp, NULL, &ctx.heap_nodes);
+// INIT SRC NODE -- all other cells are inserted once they are reached
+    p = &buff[from.y][from.x];
+    p->visit = stamp;
+    p->cost = 0;
+    p->hn = heap_insert(&h, p);
 // ALGO
     while((p = static_cast<CellPathNode*>(heap_remove_min(&h))))
     {
-        if(does_qualify(l, p->pos.x, p->pos.y))
+        if(does_qualify(p->pos.x, p->pos.y))
         {
+            heap_delete(&h);
             return p->pos;
         }
 
         p->hn = NULL;   // node was deleted from the heap
 
-        int32_t p_cost;
+        for_each_neighbor<Diag>(p->pos,
+            [&](uint16_t x, uint16_t y)
+            {
+                CellPathNode& n = buff[y][x];
+                if(n.visit == stamp)
+                {
+                    const int32_t p_cost = p->cost + cell_weight(x, y);
+                    if(n.hn && n.cost > p_cost)
+                    {
+                        n.cost = p_cost;
+                        n.from = p->pos;
+                        heap_decrease_key_no_replace(&h, n.hn);
+                    }
+                }
+                else if(should_use_cell(x, y))
+                {
+                    n.visit = stamp;
+                    n.cost = p->cost + cell_weight(x, y);
+                    n.from = p->pos;
+                    n.hn = heap_insert(&h, &n);
+                }
+            } );
+    }
+
+    heap_delete(&h);
+    return Vec2u16{ 0, 0 };
+}
+
+template<bool Diag, typename UseF, typename WeightF>
+static int repair_core(
+    PathingContext& ctx,
+    DungeonLevel::DungeonCostMap& costs,
+    const Vec2u16* cells,
+    size_t n_cells,
+    UseF&& should_use_cell,
+    WeightF&& cell_weight,
+    int32_t max_weight )
+{
+    BucketQueue& q = ctx.queue;
+    std::vector<std::pair<int32_t, uint32_t>>& seeds = ctx.seeds;
+    const uint32_t w = static_cast<uint32_t>(costs.width());
+    uint32_t i;
+
+    if(max_weight <= 0) return -1;
+
+// SEED EDITED CELLS WITH THEIR BEST COST FROM AN UNCHANGED NEIGHBOR
+    seeds.clear();
+    for(size_t c = 0; c < n_cells; c++)
+    {
+        const Vec2u16 v = cells[c];
+        int32_t& v_cost = costs[v.y][v.x];
+
+        if(!should_use_cell(v.x, v.y))
+        {
+            if(v_cost != std::numeric_limits<int32_t>::max()) return -1;   // weight increased -- can't repair
+            continue;
+        }
+        if(!v_cost) continue;   // source cell
+
+        int32_t best = std::numeric_limits<int32_t>::max();
+        for_each_neighbor<Diag>(v,
+            [&](uint16_t x, uint16_t y)
+            {
+                best = std::min(best, costs[y][x]);
+            } );
+        if(best == std::numeric_limits<int32_t>::max()) continue;
 
-        // CHECK CARDINAL DIRECTIONS
-    #define CHECK_NEIGHBOR(x, y) \
-        p_cost = p->cost + cell_weight(l, x, y); \
-        if( (buff[(y)][(x)].hn) && (buff[(y)][(x)].cost > p_cost) ) \
-        { \
-            buff[(y)][(x)].cost = p_cost; \
-            buff[(y)][(x)].from = p->pos; \
-            heap_decrease_key_no_replace(&h, buff[(y)][(x)].hn); \
+        best += cell_weight(v.x, v.y);
+        if(best < v_cost)
+        {
+            v_cost = best;
+            seeds.emplace_back(best, v.y * w + v.x);
         }
+    }
+    if(seeds.empty()) return 0;
 
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y - 1)
-        CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y)
-        CHECK_NEIGHBOR(p->pos.x, p->pos.y + 1)
-        if(use_diag)
+    std::sort(seeds.begin(), seeds.end());
+// ALGO -- seeds are fed in as the frontier reaches their cost so that queued keys stay within range
+    q.reset(costs.size(), static_cast<uint32_t>(max_weight), seeds.front().first);
+    for(size_t s = 0;;)
+    {
+        for(; s < seeds.size() && (q.empty() || static_cast<uint32_t>(seeds[s].first) <= q.minKey()); s++)
         {
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x - 1, p->pos.y + 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y - 1)
-            CHECK_NEIGHBOR(p->pos.x + 1, p->pos.y + 1)
+            const uint32_t si = seeds[s].second;
+            if(costs[si / w][si % w] == seeds[s].first && !q.contains(si))
+            {
+                q.push(si, seeds[s].first);
+            }
         }
-    #undef CHECK_NEIGHBOR
+        if((i = q.pop()) == BucketQueue::NIL) break;
+
+        const Vec2u16 p{ static_cast<uint16_t>(i % w), static_cast<uint16_t>(i / w) };
+        const int32_t c = costs[p.y][p.x];
+
+        for_each_neighbor<Diag>(p,
+            [&](uint16_t x, uint16_t y)
+            {
+                if(!should_use_cell(x, y)) return;
+
+                const int32_t p_cost = c + cell_weight(x, y);
+                if(costs[y][x] > p_cost)
+                {
+                    costs[y][x] = p_cost;
+                    if(q.contains(y * w + x)) q.decrease(y * w + x, p_cost);
+                    else q.push(y * w + x, p_cost);
+                }
+            } );
     }
 
-    heap_delete(&h);
-    return Vec2u8{ 0, 0 };
+    return 0;
 }
 
 
 
+// C-STYLE ENTRY POINTS -- adapt the function pointer policies onto the templated core
 
+#define DISPATCH_DIAG(use_diag, core, ...) \
+    ((use_diag) ? core<true>(__VA_ARGS__) : core<false>(__VA_ARGS__))
 
-namespace reuse
+int dungeon_dijkstra_single_path(
+    PathingContext& ctx,
+    const DungeonLevel::TerrainMap& map,
+    void* out,
+    Vec2u16 from,
+    Vec2u16 to,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    void(*on_cell_path)(void*, uint16_t x, uint16_t y),
+    int use_diag,
+    int32_t min_weight )
 {
-    static PathFindingBuffer buff;
-    static bool init = false;
-};
+    ctx.resize(map.width(), map.height());
+
+    return DISPATCH_DIAG(use_diag, single_path_core,
+        ctx, from, to,
+        [&](uint16_t x, uint16_t y){ return should_use_cell(map, x, y); },
+        [&](uint16_t x, uint16_t y){ return cell_weight(map, x, y); },
+        [&](uint16_t x, uint16_t y){ on_cell_path(out, x, y); },
+        min_weight );
+}
 
+int dungeon_dijkstra_traverse_grid(
+    PathingContext& ctx,
+    const DungeonLevel::TerrainMap& map,
+    Vec2u16 from,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int use_diag,
+    int32_t max_weight )
+{
+    ctx.resize(map.width(), map.height());
+
+    return DISPATCH_DIAG(use_diag, traverse_core,
+        ctx, from,
+        [&](uint16_t x, uint16_t y){ return should_use_cell(map, x, y); },
+        [&](uint16_t x, uint16_t y){ return cell_weight(map, x, y); },
+        max_weight );
+}
 
-static int corridor_path_should_use(const DungeonLevel::TerrainMap& map, uint8_t x, uint8_t y)
+Vec2u16 dungeon_dijkstra_find_nearest(
+    PathingContext& ctx,
+    const DungeonLevel& l,
+    Vec2u16 from,
+    int(*should_use_cell)(const DungeonLevel&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel&, uint16_t x, uint16_t y),
+    bool(*does_qualify)(const DungeonLevel&, uint16_t x, uint16_t y),
+    int use_diag )
 {
-    return map.hardness[y][x] != 0xFF;
+    ctx.resize(l.map.width(), l.map.height());
+
+    return DISPATCH_DIAG(use_diag, find_nearest_core,
+        ctx, from,
+        [&](uint16_t x, uint16_t y){ return should_use_cell(l, x, y); },
+        [&](uint16_t x, uint16_t y){ return cell_weight(l, x, y); },
+        [&](uint16_t x, uint16_t y){ return does_qualify(l, x, y); } );
 }
-static int32_t corridor_path_cell_weight(const DungeonLevel::TerrainMap& map, uint8_t x, uint8_t y)
+
+int dungeon_dijkstra_repair_grid(
+    PathingContext& ctx,
+    DungeonLevel::DungeonCostMap& costs,
+    const DungeonLevel::TerrainMap& map,
+    const Vec2u16* cells,
+    size_t n_cells,
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y),
+    int use_diag,
+    int32_t max_weight )
 {
-    return (int32_t)map.hardness[y][x];
+    return DISPATCH_DIAG(use_diag, repair_core,
+        ctx, costs, cells, n_cells,
+        [&](uint16_t x, uint16_t y){ return should_use_cell(map, x, y); },
+        [&](uint16_t x, uint16_t y){ return cell_weight(map, x, y); },
+        max_weight );
 }
-static void corridor_path_export(void* d, uint8_t x, uint8_t y)
+
+#undef DISPATCH_DIAG
+
+
+
+
+
+static int corridor_path_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].hardness != 0xFF;
+}
+static int32_t corridor_path_cell_weight(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return (int32_t)map.terrain[y][x].hardness;
+}
+static void corridor_path_export(void* d, uint16_t x, uint16_t y)
 {
     reinterpret_cast<DungeonLevel::TerrainMap*>(d)->terrain[y][x].type = DungeonLevel::TerrainMap::CELLTYPE_CORRIDOR;
 }
 
-int dungeon_dijkstra_corridor_path(DungeonLevel::TerrainMap& map, Vec2u8 from, Vec2u8 to)
+int dungeon_dijkstra_corridor_path(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from, Vec2u16 to)
 {
-    if(!reuse::init)
+    ctx.resize(map.width(), map.height());
+
+    uint8_t min_hardness = 0xFF;
+    for(size_t y = 1; y < map.height() - 1u; y++)
     {
-        init_pathing_buffer(reuse::buff);
-        reuse::init = true;
+        for(size_t x = 1; x < map.width() - 1u; x++)
+        {
+            min_hardness = std::min(min_hardness, map.terrain[y][x].hardness);
+        }
     }
 
-    return dungeon_dijkstra_single_path(
-        reuse::buff, map, &map, from, to,
-        corridor_path_should_use,
-        corridor_path_cell_weight,
-        corridor_path_export,
-        false );
+    return single_path_core<false>(
+        ctx, from, to,
+        [&map](uint16_t x, uint16_t y){ return corridor_path_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return corridor_path_cell_weight(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ corridor_path_export(&map, x, y); },
+        min_hardness );
 }
 
 
 
-static int floor_traversal_should_use(const DungeonLevel::TerrainMap& map, uint8_t x, uint8_t y)
+/* Every room seeds one shared traversal, which splits the map into the cells
+ * closest to each room. Neighboring cells claimed by different rooms bridge
+ * those rooms at the cost of both halves, and Kruskal over the bridges picks a
+ * minimum spanning tree of rooms. Each chosen bridge is carved back to both of
+ * its rooms through the traversal's predecessors. */
+int dungeon_dijkstra_corridor_tree(PathingContext& ctx, DungeonLevel::TerrainMap& map)
+{
+    struct Bridge
+    {
+        int32_t cost;
+        uint32_t a, b;
+
+        inline bool operator<(const Bridge& other) const
+        {
+            return std::tie(this->cost, this->a, this->b) < std::tie(other.cost, other.a, other.b);
+        }
+    };
+
+    const size_t w = map.width(), h = map.height();
+    const size_t n_rooms = map.rooms.size();
+    if(n_rooms < 2) return 0;
+
+    ctx.resize(w, h);
+    PathFindingBuffer& buff = ctx.buff;
+
+    multi_traverse_core<false>(
+        ctx,
+        [&map, n_rooms](auto&& emit)
+        {
+            for(size_t r = 0; r < n_rooms; r++)
+            {
+                const DungeonLevel::TerrainMap::Room& room = map.rooms[r];
+                for(uint16_t y = room.tl.y; y <= room.br.y; y++)
+                {
+                    for(uint16_t x = room.tl.x; x <= room.br.x; x++) emit(x, y, static_cast<uint16_t>(r));
+                }
+            }
+        },
+        [&map](uint16_t x, uint16_t y){ return corridor_path_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return corridor_path_cell_weight(map, x, y); } );
+
+// COLLECT BRIDGES BETWEEN ROOM REGIONS
+    std::vector<Bridge> bridges;
+    for(size_t y = 1; y + 1 < h; y++)
+    {
+        for(size_t x = 1; x + 1 < w; x++)
+        {
+            const CellPathNode& c = buff[y][x];
+            if(c.cost == std::numeric_limits<int32_t>::max()) continue;
+
+            const CellPathNode* neighbors[2] = { &buff[y][x + 1], &buff[y + 1][x] };
+            for(const CellPathNode* n : neighbors)
+            {
+                if(n->cost == std::numeric_limits<int32_t>::max() || n->source == c.source) continue;
+
+                bridges.push_back(
+                    Bridge
+                    {
+                        c.cost + n->cost,
+                        static_cast<uint32_t>(y * w + x),
+                        static_cast<uint32_t>(n->pos.y * w + n->pos.x)
+                    } );
+            }
+        }
+    }
+    std::sort(bridges.begin(), bridges.end());
+
+// KRUSKAL -- CARVE EACH BRIDGE THAT JOINS TWO COMPONENTS
+    std::vector<uint32_t> root(n_rooms);
+    for(size_t r = 0; r < n_rooms; r++) root[r] = static_cast<uint32_t>(r);
+    auto find = [&root](uint32_t r)
+    {
+        while(root[r] != r) r = root[r] = root[root[r]];
+        return r;
+    };
+
+    size_t joined = 1;
+    for(const Bridge& b : bridges)
+    {
+        const uint32_t
+            ra = find(buff.data()[b.a].source),
+            rb = find(buff.data()[b.b].source);
+        if(ra == rb) continue;
+
+        root[ra] = rb;
+        for(uint32_t i : { b.a, b.b })
+        {
+            // seeds are their own predecessor (costs can't tell, since zero weight cells exist)
+            for(const CellPathNode* p = &buff.data()[i]; p->from != p->pos; p = &buff[p->from.y][p->from.x])
+            {
+                corridor_path_export(&map, p->pos.x, p->pos.y);
+            }
+        }
+        if(++joined == n_rooms) break;
+    }
+
+    return 0;
+}
+
+
+
+static int floor_traversal_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
 {
     return map.terrain[y][x].type != DungeonLevel::TerrainMap::CELLTYPE_ROCK;
 }
-static int32_t floor_traversal_cell_weight(const DungeonLevel::TerrainMap& d, uint8_t x, uint8_t y)
+static int32_t floor_traversal_cell_weight(const DungeonLevel::TerrainMap& d, uint16_t x, uint16_t y)
 {
     return 1;
 }
 
-int dungeon_dijkstra_traverse_floor(DungeonLevel::TerrainMap& map, Vec2u8 from, PathFindingBuffer buff)
+int dungeon_dijkstra_traverse_floor(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from)
 {
-    return dungeon_dijkstra_traverse_grid(
-        buff, map, from,
-        floor_traversal_should_use,
-        floor_traversal_cell_weight,
-        true );
+    ctx.resize(map.width(), map.height());
+
+    return traverse_core<true>(
+        ctx, from,
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_cell_weight(map, x, y); },
+        1 );
+}
+
+
+
+int dungeon_bitwise_traverse_floor(
+    PathingContext& ctx,
+    const DungeonLevel::TerrainMap& map,
+    Vec2u16 from,
+    DungeonLevel::DungeonCostMap& costs )
+{
+    const size_t w = map.width(), h = map.height();
+    ctx.resize(w, h);
+
+    const BitRows& open = map.floor_mask;
+    BitRows
+        &seen = ctx.bfs_seen,
+        *front = &ctx.bfs_front[0],
+        *next = &ctx.bfs_front[1];
+    uint64_t* grow = ctx.bfs_grow[0];
+    const size_t n_words = open.rowWords();
+
+// RESET ALL WEIGHTS TO MAX -- the floor rows are kept by the map
+    seen.clear();
+    costs.fill(std::numeric_limits<int32_t>::max());
+// INIT SRC NODE
+    costs[from.y][from.x] = 0;
+    if(!open.test(from.y, from.x)) return 0;
+    front->clearRow(from.y);
+    front->set(from.y, from.x);
+    seen.set(from.y, from.x);
+// ALGO -- each pass grows the frontier one step in all 8 directions. Only rows
+// within [y_lo, y_hi] of the current frontier are valid.
+    size_t y_lo = from.y, y_hi = from.y;
+    for(int32_t d = 1; y_lo <= y_hi; d++)
+    {
+        const size_t
+            lo = (y_lo > 0 ? y_lo - 1 : 0),
+            hi = (y_hi + 1 < h ? y_hi + 1 : h - 1);
+        size_t n_lo = h, n_hi = 0;
+
+        for(size_t y = lo; y <= hi; y++)
+        {
+            const uint64_t
+                *above = (y > y_lo) ? (*front)[y - 1] : nullptr,
+                *center = (y >= y_lo && y <= y_hi) ? (*front)[y] : nullptr,
+                *below = (y + 1 <= y_hi) ? (*front)[y + 1] : nullptr,
+                *o = open[y];
+            uint64_t *s = seen[y], *n = (*next)[y];
+
+            for(size_t i = 0; i < n_words; i++)
+            {
+                grow[i] = (above ? above[i] : 0) | (center ? center[i] : 0) | (below ? below[i] : 0);
+            }
+            // dilate horizontally, carrying across word boundaries, then drop walls and seen cells
+            uint64_t any = 0;
+            for(size_t i = 0; i < n_words; i++)
+            {
+                const uint64_t
+                    g = grow[i],
+                    up = (g << 1) | (i > 0 ? grow[i - 1] >> 63 : 0),
+                    down = (g >> 1) | (i + 1 < n_words ? grow[i + 1] << 63 : 0);
+
+                n[i] = (g | up | down) & o[i] & ~s[i];
+                any |= n[i];
+            }
+            if(!any) continue;
+
+            for(size_t i = 0; i < n_words; i++) s[i] |= n[i];
+            BitRows::forEachSet(n, n_words, [&](size_t x){ costs[y][x] = d; });
+
+            if(y < n_lo) n_lo = y;
+            n_hi = y;
+        }
+
+        std::swap(front, next);
+        y_lo = n_lo;
+        y_hi = n_hi;
+    }
+
+    return 0;
 }
 
 
 
-static int open_entity_cell_should_use(const DungeonLevel& l, uint8_t x, uint8_t y)
+static int open_entity_cell_should_use(const DungeonLevel& l, uint16_t x, uint16_t y)
 {
     return floor_traversal_should_use(l.map, x, y);
 }
-static int32_t open_entity_cell_weight(const DungeonLevel& l, uint8_t x, uint8_t y)
+static int32_t open_entity_cell_weight(const DungeonLevel& l, uint16_t x, uint16_t y)
 {
     return 1;
 }
-static bool open_entity_cell_does_qualify(const DungeonLevel& l, uint8_t x, uint8_t y)
+static bool open_entity_cell_does_qualify(const DungeonLevel& l, uint16_t x, uint16_t y)
 {
     return !l.item_map[y][x];
 }
 
-Vec2u8 dungeon_dijkstra_nearest_open_drop(DungeonLevel& l, Vec2u8 from)
+Vec2u16 dungeon_dijkstra_nearest_open_drop(PathingContext& ctx, DungeonLevel& l, Vec2u16 from)
 {
-    if(!reuse::init)
-    {
-        init_pathing_buffer(reuse::buff);
-        reuse::init = true;
-    }
+    ctx.resize(l.map.width(), l.map.height());
 
-    return dungeon_dijkstra_find_nearest(
-        reuse::buff,
-        l,
-        from,
-        open_entity_cell_should_use,
-        open_entity_cell_weight,
-        open_entity_cell_does_qualify,
-        true );
+    return find_nearest_core<true>(
+        ctx, from,
+        [&l](uint16_t x, uint16_t y){ return open_entity_cell_should_use(l, x, y); },
+        [&l](uint16_t x, uint16_t y){ return open_entity_cell_weight(l, x, y); },
+        [&l](uint16_t x, uint16_t y){ return open_entity_cell_does_qualify(l, x, y); } );
 }
 
 
 
-static int terrain_traversal_should_use(const DungeonLevel::TerrainMap& map, uint8_t x, uint8_t y)
+static int terrain_traversal_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
 {
-    return map.hardness[y][x] != 0xFF;
+    return map.terrain[y][x].hardness != 0xFF;
 }
-static int32_t terrain_traversal_cell_weight(const DungeonLevel::TerrainMap& map, uint8_t x, uint8_t y)
+static int32_t terrain_traversal_cell_weight(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
 {
-    return map.terrain[y][x].type == DungeonLevel::TerrainMap::CELLTYPE_ROCK ? (1 + map.hardness[y][x] / 85) : 1;
+    return map.terrain[y][x].type == DungeonLevel::TerrainMap::CELLTYPE_ROCK ? (1 + map.terrain[y][x].hardness / 85) : 1;
 }
 
-int dungeon_dijkstra_traverse_terrain(DungeonLevel::TerrainMap& map, Vec2u8 from, PathFindingBuffer buff)
+int dungeon_dijkstra_traverse_terrain(PathingContext& ctx, DungeonLevel::TerrainMap& map, Vec2u16 from)
 {
-    return dungeon_dijkstra_traverse_grid(
-        buff, map, from,
-        terrain_traversal_should_use,
-        terrain_traversal_cell_weight,
-        true );
+    ctx.resize(map.width(), map.height());
+
+    return traverse_core<true>(
+        ctx, from,
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_cell_weight(map, x, y); },
+        (1 + 0xFE / 85) );
 }
 
 
 
-int dungeon_dijkstra_floor_path(
+int dungeon_dijkstra_repair_floor(
+    PathingContext& ctx,
     DungeonLevel::TerrainMap& map,
-    Vec2u8 from, Vec2u8 to,
-    void* out, void(*on_path_cell)(void*, uint8_t x, uint8_t y) )
+    DungeonLevel::DungeonCostMap& costs,
+    const Vec2u16* cells, size_t n_cells )
 {
-    if(!reuse::init)
-    {
-        init_pathing_buffer(reuse::buff);
-        reuse::init = true;
-    }
+    return repair_core<true>(
+        ctx, costs, cells, n_cells,
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_cell_weight(map, x, y); },
+        1 );
+}
+int dungeon_dijkstra_repair_terrain(
+    PathingContext& ctx,
+    DungeonLevel::TerrainMap& map,
+    DungeonLevel::DungeonCostMap& costs,
+    const Vec2u16* cells, size_t n_cells )
+{
+    return repair_core<true>(
+        ctx, costs, cells, n_cells,
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_cell_weight(map, x, y); },
+        (1 + 0xFE / 85) );
+}
 
-    return dungeon_dijkstra_single_path(
-        reuse::buff, map, out, from, to,
-        floor_traversal_should_use,
-        floor_traversal_cell_weight,
-        on_path_cell,
-        true );
+
+
+int dungeon_dijkstra_floor_path(
+    PathingContext& ctx,
+    DungeonLevel::TerrainMap& map,
+    Vec2u16 from, Vec2u16 to,
+    void* out, void(*on_path_cell)(void*, uint16_t x, uint16_t y) )
+{
+    ctx.resize(map.width(), map.height());
+
+    return single_path_core<true>(
+        ctx, from, to,
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return floor_traversal_cell_weight(map, x, y); },
+        [=](uint16_t x, uint16_t y){ on_path_cell(out, x, y); },
+        1 );
 }
 int dungeon_dijkstra_terrain_path(
+    PathingContext& ctx,
     DungeonLevel::TerrainMap& map,
-    Vec2u8 from, Vec2u8 to,
-    void* out, void(*on_path_cell)(void*, uint8_t x, uint8_t y) )
+    Vec2u16 from, Vec2u16 to,
+    void* out, void(*on_path_cell)(void*, uint16_t x, uint16_t y) )
 {
-    if(!reuse::init)
-    {
-        init_pathing_buffer(reuse::buff);
-        reuse::init = true;
-    }
-
-    return dungeon_dijkstra_single_path(
-        reuse::buff, map, out, from, to,
-        terrain_traversal_should_use,
-        terrain_traversal_cell_weight,
-        on_path_cell,
-        true );
+    ctx.resize(map.width(), map.height());
+
+    return single_path_core<true>(
+        ctx, from, to,
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_should_use(map, x, y); },
+        [&map](uint16_t x, uint16_t y){ return terrain_traversal_cell_weight(map, x, y); },
+        [=](uint16_t x, uint16_t y){ on_path_cell(out, x, y); },
+        1 );
 }
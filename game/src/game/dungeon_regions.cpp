@@ -0,0 +1,413 @@
+#include "dungeon.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <vector>
+
+
+using RegionGraph = DungeonLevel::RegionGraph;
+using TerrainMap = DungeonLevel::TerrainMap;
+
+static constexpr const auto& OFF_DIRECTIONS = DungeonLevel::MOVE_OFFSETS;
+static constexpr int32_t UNREACHED = std::numeric_limits<int32_t>::max();
+
+/* Per-thread scratch for region searches, so that a graph which is already up
+ * to date can be queried from several threads at once. */
+struct RegionSearch
+{
+    std::vector<uint32_t> queue;
+    std::vector<int32_t> dist;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> stamp;
+    uint32_t cur_stamp{ 0 };
+
+    std::vector<int32_t> to_dist;       // target to each portal of the target region
+    std::vector<int32_t> node_cost;     // coarse search, one entry per portal plus the target
+    std::vector<uint32_t> node_prev;
+    std::vector<std::pair<int32_t, uint32_t>> open;
+
+    inline void fit(size_t n_cells)
+    {
+        if(this->stamp.size() < n_cells)
+        {
+            this->dist.resize(n_cells);
+            this->parent.resize(n_cells);
+            this->stamp.assign(n_cells, 0);
+            this->cur_stamp = 0;
+        }
+    }
+    inline int32_t distAt(uint32_t i) const
+    {
+        return this->stamp[i] == this->cur_stamp ? this->dist[i] : UNREACHED;
+    }
+
+    static RegionSearch& local()
+    {
+        static thread_local RegionSearch s;
+        return s;
+    }
+};
+
+static inline int32_t chebyshev(Vec2u16 a, Vec2u16 b)
+{
+    return std::max(
+        std::abs(static_cast<int32_t>(a.x) - b.x),
+        std::abs(static_cast<int32_t>(a.y) - b.y) );
+}
+
+// breadth first search from src over the cells of region r only
+static void region_bfs(const RegionGraph& g, RegionSearch& s, uint32_t r, uint32_t src)
+{
+    const size_t w = g.region_map.width();
+    const uint32_t* regions = g.region_map.data();
+
+    if(!++s.cur_stamp)
+    {
+        std::fill(s.stamp.begin(), s.stamp.end(), 0);
+        s.cur_stamp = 1;
+    }
+
+    s.queue.clear();
+    s.queue.push_back(src);
+    s.stamp[src] = s.cur_stamp;
+    s.dist[src] = 0;
+    s.parent[src] = RegionGraph::NONE;
+
+    for(size_t q = 0; q < s.queue.size(); q++)
+    {
+        const uint32_t i = s.queue[q];
+        const int32_t d = s.dist[i] + 1;
+
+        // region cells are never on the border, so neighbors are always in bounds
+        for(uint32_t k = 0; k < 8; k++)
+        {
+            const uint32_t n = i + OFF_DIRECTIONS[k][1] * static_cast<int64_t>(w) + OFF_DIRECTIONS[k][0];
+            if(regions[n] != r || s.stamp[n] == s.cur_stamp) continue;
+
+            s.stamp[n] = s.cur_stamp;
+            s.dist[n] = d;
+            s.parent[n] = i;
+            s.queue.push_back(n);
+        }
+    }
+}
+
+
+
+void RegionGraph::build(const TerrainMap& map)
+{
+    const size_t w = map.width(), h = map.height();
+
+    this->region_map.resize(w, h, NONE);
+    this->portal_map.resize(w, h, NONE);
+    this->regions.clear();
+    this->dirty_regions.clear();
+
+    // flood 8-connected cells of the same type, starting with the rooms so that region i is room i
+    std::vector<uint32_t> stack;
+    auto flood = [&](uint16_t x, uint16_t y)
+    {
+        const uint32_t r = static_cast<uint32_t>(this->regions.size());
+        const uint8_t type = map.terrain[y][x].type;
+        Region& reg = this->regions.emplace_back();
+
+        stack.clear();
+        stack.push_back(y * w + x);
+        this->region_map.data()[y * w + x] = r;
+        while(!stack.empty())
+        {
+            const uint32_t i = stack.back();
+            stack.pop_back();
+            reg.cells.push_back(i);
+
+            for(uint32_t k = 0; k < 8; k++)
+            {
+                const uint32_t n = i + OFF_DIRECTIONS[k][1] * static_cast<int64_t>(w) + OFF_DIRECTIONS[k][0];
+                if(this->region_map.data()[n] != NONE || map.terrain.data()[n].type != type) continue;
+
+                this->region_map.data()[n] = r;
+                stack.push_back(n);
+            }
+        }
+        this->dirty_regions.push_back(r);
+    };
+
+    for(const TerrainMap::Room& room : map.rooms)
+    {
+        if(this->region_map[room.tl.y][room.tl.x] == NONE && map.terrain[room.tl.y][room.tl.x].isFloor())
+        {
+            flood(room.tl.x, room.tl.y);
+        }
+        else
+        {
+            // keep region indices lined up with the room list
+            this->regions.emplace_back().dirty = false;
+        }
+    }
+    for(size_t y = 1; y + 1 < h; y++)
+    {
+        for(size_t x = 1; x + 1 < w; x++)
+        {
+            if(this->region_map[y][x] == NONE && map.terrain[y][x].isFloor()) flood(x, y);
+        }
+    }
+
+    this->valid = true;
+    this->stale_nodes = true;
+}
+
+void RegionGraph::refreshRegion(uint32_t r)
+{
+    RegionSearch& s = RegionSearch::local();
+    Region& reg = this->regions[r];
+    const size_t w = this->region_map.width();
+    const uint32_t* regions = this->region_map.data();
+
+    s.fit(this->region_map.size());
+
+    for(Vec2u16 p : reg.portals) this->portal_map[p.y][p.x] = NONE;
+    reg.portals.clear();
+
+    for(uint32_t i : reg.cells)
+    {
+        for(uint32_t k = 0; k < 8; k++)
+        {
+            const uint32_t n = regions[i + OFF_DIRECTIONS[k][1] * static_cast<int64_t>(w) + OFF_DIRECTIONS[k][0]];
+            if(n != NONE && n != r)
+            {
+                this->portal_map.data()[i] = static_cast<uint32_t>(reg.portals.size());
+                reg.portals.emplace_back(i % w, i / w);
+                break;
+            }
+        }
+    }
+
+    const size_t n_portals = reg.portals.size();
+    reg.portal_dist.resize(n_portals * n_portals);
+    for(size_t a = 0; a < n_portals; a++)
+    {
+        region_bfs(*this, s, r, reg.portals[a].y * w + reg.portals[a].x);
+        for(size_t b = 0; b < n_portals; b++)
+        {
+            reg.portal_dist[a * n_portals + b] = s.distAt(reg.portals[b].y * w + reg.portals[b].x);
+        }
+    }
+
+    reg.dirty = false;
+}
+
+void RegionGraph::markDirty(uint32_t r)
+{
+    if(!this->regions[r].dirty)
+    {
+        this->regions[r].dirty = true;
+        this->dirty_regions.push_back(r);
+    }
+    this->stale_nodes = true;
+}
+
+void RegionGraph::update(const TerrainMap& map)
+{
+    if(!this->valid || this->region_map.width() != map.width() || this->region_map.height() != map.height())
+    {
+        this->build(map);
+    }
+
+    for(uint32_t r : this->dirty_regions)
+    {
+        if(this->regions[r].dirty) this->refreshRegion(r);
+    }
+    this->dirty_regions.clear();
+
+    if(this->stale_nodes)
+    {
+        this->node_base.resize(this->regions.size());
+        this->node_region.clear();
+        for(uint32_t r = 0; r < this->regions.size(); r++)
+        {
+            this->node_base[r] = static_cast<uint32_t>(this->node_region.size());
+            this->node_region.insert(this->node_region.end(), this->regions[r].portals.size(), r);
+        }
+        this->stale_nodes = false;
+    }
+}
+
+void RegionGraph::addFloorCell(const TerrainMap& map, Vec2u16 c)
+{
+    if(!this->valid) return;    // rebuilt from scratch on the next update anyway
+
+    const size_t w = this->region_map.width();
+    const uint32_t ci = c.y * w + c.x;
+    if(this->region_map.data()[ci] != NONE) return;
+
+    // the new corridor cell joins (and merges) every corridor region it touches, and adds portals to touching rooms
+    uint32_t corridors[8];
+    uint32_t n_corridors = 0;
+    uint32_t keep = NONE;
+    for(uint32_t k = 0; k < 8; k++)
+    {
+        const uint32_t n = ci + OFF_DIRECTIONS[k][1] * static_cast<int64_t>(w) + OFF_DIRECTIONS[k][0];
+        const uint32_t r = this->region_map.data()[n];
+        if(r == NONE) continue;
+
+        if(map.terrain.data()[n].type == TerrainMap::CELLTYPE_CORRIDOR)
+        {
+            if(std::find(corridors, corridors + n_corridors, r) != corridors + n_corridors) continue;
+            corridors[n_corridors++] = r;
+            if(keep == NONE || this->regions[r].cells.size() > this->regions[keep].cells.size()) keep = r;
+        }
+        else
+        {
+            this->markDirty(r);
+        }
+    }
+
+    if(keep == NONE)
+    {
+        keep = static_cast<uint32_t>(this->regions.size());
+        this->regions.emplace_back().dirty = false;
+    }
+    for(uint32_t i = 0; i < n_corridors; i++)
+    {
+        const uint32_t r = corridors[i];
+        if(r == keep) continue;
+
+        Region& merged = this->regions[r];
+        for(uint32_t cell : merged.cells) this->region_map.data()[cell] = keep;
+        for(Vec2u16 p : merged.portals) this->portal_map[p.y][p.x] = NONE;
+        this->regions[keep].cells.insert(this->regions[keep].cells.end(), merged.cells.begin(), merged.cells.end());
+
+        merged = Region{};
+        merged.dirty = false;
+    }
+
+    this->region_map.data()[ci] = keep;
+    this->regions[keep].cells.push_back(ci);
+    this->markDirty(keep);
+}
+
+bool RegionGraph::isCurrent(const TerrainMap& map) const
+{
+    return this->valid &&
+        this->region_map.width() == map.width() &&
+        this->region_map.height() == map.height() &&
+        this->dirty_regions.empty() &&
+        !this->stale_nodes;
+}
+
+bool RegionGraph::nextStep(const TerrainMap& map, Vec2u16 from, Vec2u16 to, Vec2u16& step)
+{
+    this->update(map);
+    return this->firstStep(from, to, step);
+}
+
+bool RegionGraph::firstStep(Vec2u16 from, Vec2u16 to, Vec2u16& step) const
+{
+    const size_t w = this->region_map.width();
+    const uint32_t from_i = from.y * w + from.x;
+    const uint32_t to_i = to.y * w + to.x;
+    const uint32_t rs = this->region_map.data()[from_i];
+    const uint32_t rt = this->region_map.data()[to_i];
+    if(rs == NONE || rt == NONE || from_i == to_i) return false;
+
+    RegionSearch& s = RegionSearch::local();
+    s.fit(this->region_map.size());
+
+    const Region& start = this->regions[rs];
+    const Region& target = this->regions[rt];
+    const uint32_t n_nodes = static_cast<uint32_t>(this->node_region.size());
+    const uint32_t target_node = n_nodes;
+
+    // LOCAL DISTANCES FROM THE TARGET TO ITS PORTALS
+    region_bfs(*this, s, rt, to_i);
+    s.to_dist.resize(target.portals.size());
+    for(size_t j = 0; j < target.portals.size(); j++)
+    {
+        s.to_dist[j] = s.distAt(target.portals[j].y * w + target.portals[j].x);
+    }
+
+    // LOCAL SEARCH FROM THE START -- KEPT AROUND FOR REFINING THE FIRST STEP
+    region_bfs(*this, s, rs, from_i);
+
+    // COARSE SEARCH OVER PORTALS
+    s.node_cost.assign(n_nodes + 1, UNREACHED);
+    s.node_prev.assign(n_nodes + 1, NONE);
+    s.open.clear();
+
+    auto node_pos = [&](uint32_t n)
+    {
+        return n == target_node ? to : this->regions[this->node_region[n]].portals[n - this->node_base[this->node_region[n]]];
+    };
+    auto relax = [&](uint32_t n, uint32_t prev, int32_t cost)
+    {
+        if(cost < s.node_cost[n])
+        {
+            s.node_cost[n] = cost;
+            s.node_prev[n] = prev;
+            s.open.emplace_back(-(cost + chebyshev(node_pos(n), to)), n);
+            std::push_heap(s.open.begin(), s.open.end());
+        }
+    };
+
+    for(size_t j = 0; j < start.portals.size(); j++)
+    {
+        relax(this->node_base[rs] + j, NONE, s.distAt(start.portals[j].y * w + start.portals[j].x));
+    }
+    if(rs == rt) relax(target_node, NONE, s.distAt(to_i));
+
+    while(!s.open.empty())
+    {
+        std::pop_heap(s.open.begin(), s.open.end());
+        const auto [f, u] = s.open.back();
+        s.open.pop_back();
+
+        if(u == target_node) break;
+        const Vec2u16 p = node_pos(u);
+        if(-f != s.node_cost[u] + chebyshev(p, to)) continue;  // stale entry
+
+        const uint32_t r = this->node_region[u];
+        const Region& reg = this->regions[r];
+        const uint32_t i = u - this->node_base[r];
+        const size_t n_portals = reg.portals.size();
+        const int32_t g = s.node_cost[u];
+
+        for(size_t j = 0; j < n_portals; j++)
+        {
+            const int32_t d = reg.portal_dist[i * n_portals + j];
+            if(j != i && d != UNREACHED) relax(this->node_base[r] + j, u, g + d);
+        }
+        if(r == rt && s.to_dist[i] != UNREACHED) relax(target_node, u, g + s.to_dist[i]);
+
+        for(uint32_t k = 0; k < 8; k++)
+        {
+            const uint32_t n = p.y * w + p.x + OFF_DIRECTIONS[k][1] * static_cast<int64_t>(w) + OFF_DIRECTIONS[k][0];
+            const uint32_t nr = this->region_map.data()[n];
+            if(nr == NONE || nr == r) continue;
+
+            relax(this->node_base[nr] + this->portal_map.data()[n], u, g + 1);
+        }
+    }
+    if(s.node_cost[target_node] == UNREACHED) return false;
+
+    // REFINE -- FIND THE FIRST PATH NODE OFF THE START CELL
+    uint32_t next = target_node;
+    for(uint32_t n = target_node; n != NONE; n = s.node_prev[n])
+    {
+        if(node_pos(n) != from) next = n;
+    }
+
+    const Vec2u16 goal = node_pos(next);
+    const uint32_t goal_region = next == target_node ? rt : this->node_region[next];
+    if(goal_region != rs)
+    {
+        step = goal;    // portal of a touching region
+        return true;
+    }
+
+    uint32_t i = goal.y * w + goal.x;
+    while(s.parent[i] != from_i) i = s.parent[i];
+    step.assign(i % w, i / w);
+
+    return true;
+}
@@ -3,6 +3,8 @@
 #include <unordered_map>
 #include <fstream>
 #include <atomic>
+#include <future>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
@@ -14,6 +16,7 @@
 
 #include "util/vec_geom.hpp"
 #include "util/nc_wrap.hpp"
+#include "util/lru_cache.hpp"
 
 #include "dungeon_config.h"
 
@@ -27,14 +30,14 @@ class GameState
 
 public:
     inline GameState() :
-        level{},
-        map_win{ this->level },
-        mlist_win{ this->level },
-        inv_win{ this->level }
+        level{ std::make_unique<DungeonLevel>() },
+        map_win{ *this->level },
+        mlist_win{ *this->level },
+        inv_win{ *this->level }
     {}
 
 public:
-    void initRuntimeArgs(uint32_t seed, int nmon);
+    void initRuntimeArgs(uint32_t seed, int nmon, Vec2u16 level_size);
     bool initMonDescriptions(std::istream& i);
     bool initItemDescriptions(std::istream& i);
     bool initDungeonFile(FILE* f);
@@ -49,8 +52,40 @@ protected:
     {
         return static_cast<uint32_t>(this->state.rgen());
     }
+    // levels past the first draw from their own stream per depth, untouched by gameplay draws
+    inline std::mt19937 levelRng(int32_t depth) const
+    {
+        std::seed_seq s{ this->state.seed, static_cast<uint32_t>(depth) };
+        return std::mt19937{ s };
+    }
+
+    using UniqueAvailability = std::unordered_map<const MonDescription*, bool>;
+    using ArtifactAvailability = std::unordered_map<const ItemDescription*, bool>;
 
-    bool initializeEntities();
+    inline bool initializeEntities()
+    {
+        return this->initializeEntities(
+            *this->level,
+            this->state.rgen,
+            this->unique_availability,
+            this->artifact_availability );
+    }
+    bool initializeEntities(
+        DungeonLevel& l,
+        std::mt19937& gen,
+        UniqueAvailability& uniques,
+        ArtifactAvailability& artifacts );
+    bool generateLevel(
+        DungeonLevel& l,
+        Vec2u16 size,
+        std::mt19937& gen,
+        UniqueAvailability& uniques,
+        ArtifactAvailability& artifacts );
+    void enterLevel(int32_t depth);
+#if DUNGEON_PREGENERATE_LEVELS
+    void beginNextLevel();
+    std::unique_ptr<DungeonLevel> takeNextLevel(int32_t depth);
+#endif
     void handleItemPickup();
 
     int overwrite_changes();
@@ -107,25 +142,32 @@ protected:
         inline virtual ~MapWindow() {};
 
     public:
-        void onPlayerMove(Vec2u8 a, Vec2u8 b);
-        void onMonsterMove(Vec2u8 a, Vec2u8 b, bool terrain_changed = false);
-        void onGotoMove(Vec2u8 a, Vec2u8 b);
+        void onPlayerMove(Vec2u16 a, Vec2u16 b);
+        void onMonsterMove(Vec2u16 a, Vec2u16 b, bool terrain_changed = false);
+        void onGotoMove(Vec2u16 a, Vec2u16 b);
         void onRefresh(bool force_rewrite = false);
 
         void changeMap(int mmode);
         void changeLevel(DungeonLevel& l, int mmode = -1);
 
     protected:
+        bool scrollTo(Vec2u16 focus);
+        bool inView(Vec2u16 p) const;
+        void writeCell(Vec2u16 p);
+        void putCell(Vec2u16 p, chtype c);
+
+        void writeMap();
         void writeFogMap();
         void writeDungeonMap();
         void writeHardnessMap();
-        void writeWeightMap(DungeonLevel::DungeonCostMap);
+        void writeWeightMap(const DungeonLevel::DungeonCostMap&);
 
     protected:
         struct
         {
             int map_mode{ MAP_FOG }, fogless_map_mode{ MAP_DUNGEON };
             bool needs_rewrite{ false };
+            Vec2u16 origin{ 0, 0 };     // level cell shown at the window's top left corner
         }
         state;
 
@@ -196,7 +238,7 @@ protected:
     };
 
 protected:
-    DungeonLevel level;
+    std::unique_ptr<DungeonLevel> level;
 
     MapWindow map_win;
     MListWindow mlist_win;
@@ -205,8 +247,8 @@ protected:
     std::vector<MonDescription> mon_desc;
     std::vector<ItemDescription> item_desc;
 
-    std::unordered_map<const MonDescription*, bool> unique_availability;
-    std::unordered_map<const ItemDescription*, bool> artifact_availability;
+    UniqueAvailability unique_availability;
+    ArtifactAvailability artifact_availability;
 
     struct
     {
@@ -217,11 +259,47 @@ protected:
 
         uint32_t seed;
         int nmon;
+        int32_t depth{ 0 };     // increases going down
 
         std::mt19937 rgen;
     }
     state;
 
+    /* Levels that were left through a staircase, by depth. Taking a staircase
+     * back restores the level as it was left, with the PC on the stair it left
+     * from. Cached levels drop their rebuildable scratch state, and the least
+     * recently left levels are evicted past DUNGEON_LEVEL_CACHE_MAX_BYTES. */
+    LRUCache<int32_t, std::unique_ptr<DungeonLevel>> level_cache{ DUNGEON_LEVEL_CACHE_MAX_BYTES };
+
+#if DUNGEON_PARALLEL_NPC_TURNS
+    /* NPCs due on the same tick are resolved together through
+     * DungeonLevel::iterateNPCs() once there are at least
+     * DUNGEON_PARALLEL_NPC_MIN_BATCH of them. The pool is only started the
+     * first time a batch gets that large, so small levels keep no idle threads. */
+    std::unique_ptr<ThreadPool> npc_pool;
+    std::vector<Entity*> npc_batch;
+    std::vector<DungeonLevel::EntityQueueNode> npc_batch_nodes;
+#endif
+
+#if DUNGEON_PREGENERATE_LEVELS
+    /* The next unvisited level (below, else above) is built on a worker thread
+     * while the current one is played. The worker uses the level rng for that
+     * depth and a copy of the availability tables. The level is only taken if
+     * it is the one being entered and the tables have not changed since, in
+     * which case it is identical to one built on demand -- otherwise it is
+     * discarded and the level is built on demand. */
+    struct
+    {
+        std::unique_ptr<DungeonLevel> level;
+        int32_t depth{ 0 };
+        std::mt19937 rgen;
+        UniqueAvailability unique_availability, unique_availability_in;     // worker's copy, as it was handed over
+        ArtifactAvailability artifact_availability, artifact_availability_in;
+        std::future<bool> job;  // declared last -- waits for the worker before the rest is destroyed
+    }
+    next_level;
+#endif
+
 };
 
 
@@ -1,15 +1,18 @@
 #include "game.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <cstdio>
 
 
 void GameApplication::initialize(int argc, char** argv)
 {
 // 1. Parse args
-    #define MAX_ARGN 7
+    #define MAX_ARGN 9
     int nmon = -1;
     uint32_t seed = 0;
     bool seed_arg = false;
+    Vec2u16 level_size{ DUNGEON_X_DIM, DUNGEON_Y_DIM };
     for(int n = 1; n < argc && n < MAX_ARGN; n++)
     {
         const char* arg = argv[n];
@@ -28,6 +31,17 @@ void GameApplication::initialize(int argc, char** argv)
                 seed = static_cast<uint32_t>(atoi(argv[n]));
                 seed_arg = true;
             }
+            if(!strncmp(arg + 2, "size", 4) && n + 1 < argc)
+            {
+                n++;
+                unsigned w, h;
+                if(sscanf(argv[n], "%ux%u", &w, &h) == 2)
+                {
+                    // levels can't be smaller than the default, since room placement assumes that much space
+                    level_size.x = static_cast<uint16_t>(std::clamp<unsigned>(w, DUNGEON_X_DIM, 0xFFFF));
+                    level_size.y = static_cast<uint16_t>(std::clamp<unsigned>(h, DUNGEON_Y_DIM, 0xFFFF));
+                }
+            }
         }
     }
     #undef MAX_ARGN
@@ -37,7 +51,7 @@ void GameApplication::initialize(int argc, char** argv)
         seed = static_cast<uint32_t>(std::random_device{}());
     }
 
-    this->game.initRuntimeArgs(seed, nmon);
+    this->game.initRuntimeArgs(seed, nmon, level_size);
 
 // 2. Load descriptions
     {
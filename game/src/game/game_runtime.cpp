@@ -4,8 +4,14 @@
 #include "util/debug.hpp"
 
 
-void GameState::MapWindow::onPlayerMove(Vec2u8 a, Vec2u8 b)
+void GameState::MapWindow::onPlayerMove(Vec2u16 a, Vec2u16 b)
 {
+    if(this->scrollTo(b))
+    {
+        this->state.needs_rewrite = true;
+        return;
+    }
+
     switch(this->state.map_mode)
     {
         case MAP_FOG :
@@ -17,8 +23,8 @@ void GameState::MapWindow::onPlayerMove(Vec2u8 a, Vec2u8 b)
         case MAP_DUNGEON :
         case MAP_HARDNESS :
         {
-            this->level->writeChar(this->win, a);
-            this->level->writeChar(this->win, b);
+            this->writeCell(a);
+            this->writeCell(b);
             break;
         }
         case MAP_FWEIGHT :
@@ -29,7 +35,7 @@ void GameState::MapWindow::onPlayerMove(Vec2u8 a, Vec2u8 b)
         }
     }
 }
-void GameState::MapWindow::onMonsterMove(Vec2u8 a, Vec2u8 b, bool terrain_changed)
+void GameState::MapWindow::onMonsterMove(Vec2u16 a, Vec2u16 b, bool terrain_changed)
 {
     switch(this->state.map_mode)
     {
@@ -41,8 +47,8 @@ void GameState::MapWindow::onMonsterMove(Vec2u8 a, Vec2u8 b, bool terrain_change
         case MAP_DUNGEON :
         case MAP_HARDNESS :
         {
-            this->level->writeChar(this->win, a);
-            this->level->writeChar(this->win, b);
+            this->writeCell(a);
+            this->writeCell(b);
             break;
         }
         case MAP_FWEIGHT :
@@ -53,75 +59,38 @@ void GameState::MapWindow::onMonsterMove(Vec2u8 a, Vec2u8 b, bool terrain_change
         }
     }
 }
-void GameState::MapWindow::onGotoMove(Vec2u8 a, Vec2u8 b)
+void GameState::MapWindow::onGotoMove(Vec2u16 a, Vec2u16 b)
 {
-    switch(this->state.map_mode)
+    if(this->state.map_mode != MAP_FOG &&
+        this->state.map_mode != MAP_DUNGEON &&
+        this->state.map_mode != MAP_HARDNESS ) return;
+
+    // the target cursor drags the viewport along with it
+    if(this->scrollTo(b))
     {
-        case MAP_FOG :
-        {
-            if((a.cast<int>() - this->level->pc.state.pos).lensquared() <= DungeonLevel::VIS_RADSQ)
-            {
-                this->level->writeChar(this->win, a);
-            }
-            else
-            {
-                mvwaddch(this->win, a.y, a.x, this->level->visibility_map[a.y][a.x]);
-            }
-            mvwaddch(this->win, b.y, b.x, '*');
-            break;
-        }
-        case MAP_DUNGEON :
-        case MAP_HARDNESS :
-        {
-            this->level->writeChar(this->win, a);
-            mvwaddch(this->win, b.y, b.x, '*');
-            break;
-        }
-        default: return;
+        this->writeMap();
+    }
+    else
+    if(this->state.map_mode == MAP_FOG && !this->level->isLit(a))
+    {
+        this->putCell(a, this->level->visibility_map[a.y][a.x]);
+    }
+    else
+    {
+        this->writeCell(a);
     }
+    this->putCell(b, '*');
 }
 
 void GameState::MapWindow::onRefresh(bool force_rewrite)
 {
-    switch(this->state.map_mode)
+    if(force_rewrite)
     {
-        case MAP_FOG :
-        {
-            if(force_rewrite)
-            {
-                this->writeFogMap();
-            }
-            break;
-        }
-        case MAP_DUNGEON :
-        {
-            if(force_rewrite)
-            {
-                this->writeDungeonMap();
-            }
-            break;
-        }
-        case MAP_HARDNESS :
-        {
-            if(force_rewrite)
-            {
-                this->writeHardnessMap();
-            }
-            break;
-        }
-        case MAP_FWEIGHT :
-        case MAP_TWEIGHT :
-        {
-            if(force_rewrite || this->state.needs_rewrite)
-            {
-                this->writeWeightMap(
-                    this->state.map_mode == MAP_FWEIGHT ?
-                        this->level->tunnel_costs :
-                        this->level->terrain_costs );
-            }
-            break;
-        }
-        default: return;
+        this->scrollTo(this->level->pc.state.pos);
+    }
+    if(force_rewrite || this->state.needs_rewrite)
+    {
+        this->writeMap();
     }
 
     this->state.needs_rewrite = false;
@@ -179,36 +148,104 @@ void GameState::MapWindow::changeLevel(DungeonLevel& l, int mmode)
 }
 
 
+// Moves the viewport so that focus is shown, recentering on it once it comes within
+// DUNGEON_MAP_SCROLL_MARGIN cells of an edge. Returns true if the viewport moved.
+bool GameState::MapWindow::scrollTo(Vec2u16 focus)
+{
+    const auto scroll_axis = [](uint16_t origin, uint16_t f, int32_t view, int32_t size) -> uint16_t
+    {
+        const int32_t
+            rel = static_cast<int32_t>(f) - origin,
+            margin = std::min<int32_t>(DUNGEON_MAP_SCROLL_MARGIN, (view - 2) / 4),
+            max_origin = std::max<int32_t>(size - view, 0);
+
+        if(rel > margin && rel < view - 1 - margin) return origin;
+        return static_cast<uint16_t>(std::clamp<int32_t>(static_cast<int32_t>(f) - view / 2, 0, max_origin));
+    };
+
+    const Vec2u16 prev = this->state.origin;
+    this->state.origin.x = scroll_axis(prev.x, focus.x, DUNGEON_MAP_WIN_X_DIM, this->level->width());
+    this->state.origin.y = scroll_axis(prev.y, focus.y, DUNGEON_MAP_WIN_Y_DIM, this->level->height());
+
+    return this->state.origin != prev;
+}
+// true for interior level cells that fall inside the window's border
+bool GameState::MapWindow::inView(Vec2u16 p) const
+{
+    const Vec2u16& o = this->state.origin;
+    return
+        p.x > o.x && p.x < o.x + DUNGEON_MAP_WIN_X_DIM - 1 && p.x < this->level->width() - 1 &&
+        p.y > o.y && p.y < o.y + DUNGEON_MAP_WIN_Y_DIM - 1 && p.y < this->level->height() - 1;
+}
+void GameState::MapWindow::writeCell(Vec2u16 p)
+{
+    if(this->inView(p)) this->level->writeChar(this->win, p, this->state.origin);
+}
+void GameState::MapWindow::putCell(Vec2u16 p, chtype c)
+{
+    if(this->inView(p)) mvwaddch(this->win, p.y - this->state.origin.y, p.x - this->state.origin.x, c);
+}
+
+void GameState::MapWindow::writeMap()
+{
+    switch(this->state.map_mode)
+    {
+        case MAP_FOG :      this->writeFogMap();        break;
+        case MAP_DUNGEON :  this->writeDungeonMap();    break;
+        case MAP_HARDNESS : this->writeHardnessMap();   break;
+        case MAP_FWEIGHT :
+        case MAP_TWEIGHT :
+        {
+            this->level->refreshCosts();
+            this->writeWeightMap(
+                this->state.map_mode == MAP_FWEIGHT ?
+                    this->level->tunnel_costs :
+                    this->level->terrain_costs );
+            break;
+        }
+        default: return;
+    }
+}
+
+// Visible level cells are [x_lo, x_hi) by [y_lo, y_hi), and land in the window at
+// their level position minus the viewport origin.
+#define MAP_VIEW_BOUNDS \
+    const Vec2u16 o = this->state.origin; \
+    const uint32_t \
+        x_lo = o.x + 1u, \
+        y_lo = o.y + 1u, \
+        x_hi = std::min<uint32_t>(o.x + DUNGEON_MAP_WIN_X_DIM, this->level->width()) - 1u, \
+        y_hi = std::min<uint32_t>(o.y + DUNGEON_MAP_WIN_Y_DIM, this->level->height()) - 1u;
+
 void GameState::MapWindow::writeFogMap()
 {
-    for(uint32_t y = 1; y < DUNGEON_Y_DIM - 1; y++)
+    MAP_VIEW_BOUNDS
+
+    for(uint32_t y = y_lo; y < y_hi; y++)
     {
-        mvwaddnstr(this->win, y, 1, this->level->visibility_map[y] + 1, DUNGEON_X_DIM - 2);
+        mvwaddnstr(this->win, y - o.y, 1, this->level->visibility_map[y] + x_lo, x_hi - x_lo);
     }
-    // if(this->level->pc)
-    // {
-        for(size_t i = 0; i < 21; i++)
+    // lit cells show their live contents on top of the remembered terrain
+    const Vec2u16 p = this->level->pc.state.pos;
+    const int32_t r = DungeonLevel::LIGHT_RADIUS;
+    for(int32_t y = std::max<int32_t>(p.y - r, y_lo); y <= std::min<int32_t>(p.y + r, y_hi - 1); y++)
+    {
+        for(int32_t x = std::max<int32_t>(p.x - r, x_lo); x <= std::min<int32_t>(p.x + r, x_hi - 1); x++)
         {
-            const auto v = DungeonLevel::VIS_OFFSETS[i];
-            const int8_t y = static_cast<int8_t>(this->level->pc.state.pos.y) + v[0];
-            const int8_t x = static_cast<int8_t>(this->level->pc.state.pos.x) + v[1];
-
-            if( (y >= 1 && y < DUNGEON_Y_DIM - 1 && x >= 1 && x < DUNGEON_X_DIM - 1) )
-                // (this->level->entity_map[y][x] || this->level->item_idx_map[y][x]) )
-            {
-                this->level->writeChar(this->win, {x, y});
-            }
+            if(this->level->isLit(Vec2i{ x, y })) this->writeCell(Vec2i{ x, y });
         }
-    // }
+    }
 }
 void GameState::MapWindow::writeDungeonMap()
 {
+    MAP_VIEW_BOUNDS
+
     // char row[DUNGEON_X_DIM - 2];
-    for(uint32_t y = 1; y < (DUNGEON_Y_DIM - 1); y++)
+    for(uint32_t y = y_lo; y < y_hi; y++)
     {
-        for(uint32_t x = 1; x < (DUNGEON_X_DIM - 1); x++)
+        for(uint32_t x = x_lo; x < x_hi; x++)
         {
-            this->level->writeChar(this->win, {x, y});
+            this->level->writeChar(this->win, Vec2u{ x, y }, o);
             // row[x - 1] = get_cell_char(
             //                 this->level->map.terrain[y][x],
             //                 this->level->entities[y][x] );
@@ -218,44 +255,48 @@ void GameState::MapWindow::writeDungeonMap()
 }
 void GameState::MapWindow::writeHardnessMap()
 {
-    for(uint32_t y = 1; y < (DUNGEON_Y_DIM - 1); y++)
+    MAP_VIEW_BOUNDS
+
+    for(uint32_t y = y_lo; y < y_hi; y++)
     {
-        for(uint32_t x = 1; x < (DUNGEON_X_DIM - 1); x++)
+        for(uint32_t x = x_lo; x < x_hi; x++)
         {
             DungeonLevel::TerrainMap::Cell t = this->level->map.terrain[y][x];
             if(t.type)
             {
-                this->level->writeChar(this->win, {x, y});
+                this->level->writeChar(this->win, Vec2u{ x, y }, o);
             }
             else
             {
                 this->hardness_gradient.printChar(
                     this->win,
-                    y,
-                    x,
-                    (this->level->map.hardness[y][x] / 2),
+                    y - o.y,
+                    x - o.x,
+                    (this->level->map.terrain[y][x].hardness / 2),
                     ' ' );
             }
         }
     }
 }
-void GameState::MapWindow::writeWeightMap(DungeonLevel::DungeonCostMap weights)
+void GameState::MapWindow::writeWeightMap(const DungeonLevel::DungeonCostMap& weights)
 {
-    for(uint32_t y = 1; y < (DUNGEON_Y_DIM - 1); y++)
+    MAP_VIEW_BOUNDS
+
+    for(uint32_t y = y_lo; y < y_hi; y++)
     {
-        for(uint32_t x = 1; x < (DUNGEON_X_DIM - 1); x++)
+        for(uint32_t x = x_lo; x < x_hi; x++)
         {
             const int32_t w = weights[y][x];
             if(w == std::numeric_limits<int32_t>::max())
             {
-                mvwaddch(this->win, y, x, ' ');
+                mvwaddch(this->win, y - o.y, x - o.x, ' ');
             }
             else
             {
                 this->weightmap_gradient.printChar(
                     this->win,
-                    y,
-                    x,
+                    y - o.y,
+                    x - o.x,
                     (127 - MIN_CACHED(w * 2, 127)),
                     w == 0 ? '@' : (w % 10) + '0' );
             }
@@ -263,6 +304,8 @@ void GameState::MapWindow::writeWeightMap(DungeonLevel::DungeonCostMap weights)
     }
 }
 
+#undef MAP_VIEW_BOUNDS
+
 
 
 
@@ -335,6 +378,7 @@ void GameState::MListWindow::changeLevel(DungeonLevel& l)
 
 void GameState::MListWindow::printEntry(const Entity& m, int line)
 {
+    this->level->refreshCosts();
     const int
         dx = (int)this->level->pc.state.pos.x - (int)m.state.pos.x,
         dy = (int)this->level->pc.state.pos.y - (int)m.state.pos.y,
@@ -518,8 +562,9 @@ static int nc_print_win_lose(int s, const std::atomic<bool>& r)
     {
         mvaddstr(0, 0, lose);
 
+        Pcg32 bar;
         uint8_t p = 0;
-        for(; p <= 100 && r; p = MIN_CACHED(p + RANDOM_IN_RANGE(MIN_PERCENT_CHUNK, MAX_PERCENT_CHUNK), 100))
+        for(; p <= 100 && r; p = MIN_CACHED(p + bar.range(MIN_PERCENT_CHUNK, MAX_PERCENT_CHUNK), 100))
         {
             uint8_t px = (p * LOADING_BAR_LEN) / 100;
             for(int i = LOADING_BAR_START_IDX; i <= LOADING_BAR_START_IDX + px; i++)
@@ -534,7 +579,7 @@ static int nc_print_win_lose(int s, const std::atomic<bool>& r)
             refresh();
 
             if(p >= 100) break;
-            usleep(1000 * RANDOM_IN_RANGE(MIN_PAUSE_MS, MAX_PAUSE_MS));
+            usleep(1000 * bar.range(MIN_PAUSE_MS, MAX_PAUSE_MS));
         }
 
         attron(WA_BLINK);
@@ -776,15 +821,15 @@ uint8_t UserInput::checkCarrySlot(int in)
 
 void GameState::handleItemPickup()
 {
-    Item*& iptr = DungeonLevel::accessGridElem(this->level.item_map, this->level.pc.state.pos);
-    if(size_t oi = this->level.getOpenCarrySlot(); oi < this->level.pc_carry.size() && iptr)
+    const Vec2u16 pos = this->level->pc.state.pos;
+    if(size_t oi = this->level->getOpenCarrySlot(); oi < this->level->pc_carry.size() && this->level->itemAt(pos))
     {
-        this->level.pc_carry[oi] = iptr;
+        Item* iptr = this->level->takeItem(pos);
+        this->level->pc_carry[oi] = iptr;
         if(iptr->artifact_entry)
         {
             this->artifact_availability[iptr->artifact_entry] = true;
         }
-        iptr = nullptr;
     }
 }
 
@@ -807,14 +852,14 @@ int GameState::overwrite_changes()
 
 int GameState::iterate_next_pc()
 {
-    // Heap* q = &this->level.entity_q;
+    // Heap* q = &this->level->entity_q;
     Entity* e;
     int s;
     do
     {
         // e = static_cast<Entity*>(heap_remove_min(q));
-        DungeonLevel::EntityQueueNode qn = this->level.entity_queue.top();
-        this->level.entity_queue.pop();
+        DungeonLevel::EntityQueueNode qn = this->level->entity_queue.top();
+        this->level->entity_queue.pop();
         e = qn.e;
         // FileDebug::get() << "Popped node with entity : " << std::hex << e << std::dec
         //     << ", next turn : " << qn.next_turn
@@ -823,16 +868,50 @@ int GameState::iterate_next_pc()
         {
             if(e->config.is_pc)
             {
-                qn.next_turn += (1000 / MIN_CACHED(this->level.getPCSpeed(), 1000));
-                this->level.entity_queue.push(qn);
+                qn.next_turn += (1000 / MIN_CACHED(this->level->getPCSpeed(), 1000));
+                this->level->entity_queue.push(qn);
             }
             else
             {
+            #if DUNGEON_PARALLEL_NPC_TURNS
+                // pull the rest of the NPCs due on this tick, stopping short of the PC
+                auto& q = this->level->entity_queue;
+                this->npc_batch_nodes.assign(1, qn);
+                while(!q.empty() && q.top().next_turn == qn.next_turn && !q.top().e->config.is_pc)
+                {
+                    const DungeonLevel::EntityQueueNode n = q.top();
+                    q.pop();
+
+                    if(n.e->state.health > 0) this->npc_batch_nodes.push_back(n);
+                    else if(n.e->config.unique_entry) this->unique_availability[n.e->config.unique_entry] = false;
+                }
+
+                this->npc_batch.clear();
+                for(DungeonLevel::EntityQueueNode& n : this->npc_batch_nodes)
+                {
+                    this->npc_batch.push_back(n.e);
+                    n.next_turn += (1000 / n.e->config.speed);
+                    q.push(n);
+                }
+
+                if(this->npc_batch.size() >= DUNGEON_PARALLEL_NPC_MIN_BATCH)
+                {
+                    if(!this->npc_pool) this->npc_pool = std::make_unique<ThreadPool>();
+                    this->level->iterateNPCs(this->npc_batch.data(), this->npc_batch.size(), *this->npc_pool);
+                }
+                else
+                {
+                    for(size_t i = 0; i < this->npc_batch.size() && !this->level->getWinLose(); i++)
+                    {
+                        this->level->iterateNPC(*this->npc_batch[i]);
+                    }
+                }
+            #else
                 qn.next_turn += (1000 / e->config.speed);
-                this->level.entity_queue.push(qn);
+                this->level->entity_queue.push(qn);
 
-                Vec2u8 pre = e->state.pos;
-                if(this->level.iterateNPC(*e))
+                Vec2u16 pre = e->state.pos;
+                if(this->level->iterateNPC(*e))
                 {
                     // FileDebug::get() << "\tEntity has been iterated.\n";
 
@@ -847,6 +926,7 @@ int GameState::iterate_next_pc()
                 // {
                 //     FileDebug::get() << "\tNo entity movement occurred.\n";
                 // }
+            #endif
             }
         }
         else if(e->config.unique_entry)
@@ -854,7 +934,7 @@ int GameState::iterate_next_pc()
             this->unique_availability[e->config.unique_entry] = false;
         }
     }
-    while(!(s = this->level.getWinLose()) && (!e || !e->config.is_pc));
+    while(!(s = this->level->getWinLose()) && (!e || !e->config.is_pc));
 
     this->map_win.onRefresh(true);
 
@@ -876,8 +956,8 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
        +1, +1
    };
 
-    Entity& pc = this->level.pc;
-    const DungeonLevel::TerrainMap::Cell t = this->level.map.terrain[pc.state.pos.y][pc.state.pos.x];
+    Entity& pc = this->level->pc;
+    const DungeonLevel::TerrainMap::Cell t = this->level->map.terrain[pc.state.pos.y][pc.state.pos.x];
     switch(move_cmd)
     {
         case MOVE_CMD_U:
@@ -889,8 +969,8 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
         case MOVE_CMD_DL:
         case MOVE_CMD_DR:
         {
-            Vec2u8 from;
-            const Vec2i8 d{
+            Vec2u16 from;
+            const Vec2i d{
                 off[(move_cmd - MOVE_CMD_U) * 2 + 0],
                 off[(move_cmd - MOVE_CMD_U) * 2 + 1] };
 
@@ -899,14 +979,16 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
                 from = pc.state.target_pos;
                 pc.state.target_pos += d;
 
-                pc.state.target_pos.clamp(Vec2u8{1, 1}, Vec2u8{DUNGEON_X_DIM - 2, DUNGEON_Y_DIM - 2});
+                pc.state.target_pos.clamp(
+                    Vec2u16{ 1, 1 },
+                    Vec2u16{ static_cast<uint16_t>(this->level->width() - 2), static_cast<uint16_t>(this->level->height() - 2) } );
 
                 this->map_win.onGotoMove(from, pc.state.target_pos);
             }
             else
             {
                 from = pc.state.pos;
-                if( this->level.handlePCMove(static_cast<Vec2i8>(pc.state.pos) + d, false) )
+                if( this->level->handlePCMove(static_cast<Vec2i>(pc.state.pos) + d, false) )
                 {
                     this->handleItemPickup();
                     this->map_win.onPlayerMove(from, pc.state.pos);
@@ -921,15 +1003,15 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
         {
             if(!this->state.is_goto_ctrl && (move_cmd - 9) == (int)t.is_stair)
             {
-                Vec2u8 pc_pos;
-
-                this->level.reset();
-                this->initDungeonRandom();  // TODO: handle unique item resets
+                this->enterLevel(this->state.depth + (move_cmd == MOVE_CMD_DS ? 1 : -1));   // TODO: handle unique item resets
                 NC_PRINT(" ");
 
-                this->map_win.changeLevel(this->level);
-                this->mlist_win.changeLevel(this->level);
-                this->inv_win.changeLevel(this->level);
+                this->map_win.changeLevel(*this->level);
+                this->mlist_win.changeLevel(*this->level);
+                this->inv_win.changeLevel(*this->level);
+            #if DUNGEON_PREGENERATE_LEVELS
+                this->beginNextLevel();
+            #endif
             }
             break;
         }
@@ -937,8 +1019,8 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
         {
             if(this->state.is_goto_ctrl)
             {
-                Vec2u8 from = pc.state.pos;
-                this->level.handlePCMove(pc.state.target_pos, true);
+                Vec2u16 from = pc.state.pos;
+                this->level->handlePCMove(pc.state.target_pos, true);
                 this->handleItemPickup();
                 this->map_win.onPlayerMove(from, pc.state.pos);
                 this->state.is_goto_ctrl = false;
@@ -955,8 +1037,8 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
         {
             if(this->state.is_goto_ctrl)
             {
-                Vec2u8 from = pc.state.pos;
-                if( this->level.handlePCMove(this->level.map.randomRoomFloorPos(this->state.rgen), true) )
+                Vec2u16 from = pc.state.pos;
+                if( this->level->handlePCMove(this->level->map.randomRoomFloorPos(this->state.rgen), true) )
                 {
                     this->handleItemPickup();
                     this->map_win.onPlayerMove(from, pc.state.pos);
@@ -971,7 +1053,7 @@ int GameState::iterate_pc_cmd(int move_cmd, bool& was_nop)
 
     this->map_win.onRefresh(!this->state.is_goto_ctrl);
 
-    return this->level.getWinLose();
+    return this->level->getWinLose();
 }
 
 int GameState::handle_action_cmd(int action_cmd)
@@ -995,18 +1077,18 @@ int GameState::handle_action_cmd(int action_cmd)
                 while(!(d = UserInput::checkCarrySlot(c)) && !UserInput::checkEscape(c));
                 if(d)
                 {
-                    if(Item* iptr = this->level.pc_carry[d - 1]; iptr)
+                    if(Item* iptr = this->level->pc_carry[d - 1]; iptr)
                     {
-                        size_t eqi = this->level.getEquipmentSlotIdx(*iptr);
-                        if(this->level.pc_equipment[eqi])
+                        size_t eqi = this->level->getEquipmentSlotIdx(*iptr);
+                        if(this->level->pc_equipment[eqi])
                         {
-                            this->level.pc_carry[d - 1] = this->level.pc_equipment[eqi];
+                            this->level->pc_carry[d - 1] = this->level->pc_equipment[eqi];
                         }
                         else
                         {
-                            this->level.pc_carry[d - 1] = nullptr;
+                            this->level->pc_carry[d - 1] = nullptr;
                         }
-                        this->level.pc_equipment[eqi] = iptr;
+                        this->level->pc_equipment[eqi] = iptr;
                         break;
                     }
                     else
@@ -1036,18 +1118,18 @@ int GameState::handle_action_cmd(int action_cmd)
                 while(!(d = UserInput::checkEquipSlot(c)) && !UserInput::checkEscape(c));
                 if(d)
                 {
-                    if(Item* iptr = this->level.pc_equipment[d - 1]; iptr)
+                    if(Item* iptr = this->level->pc_equipment[d - 1]; iptr)
                     {
-                        size_t cri = this->level.getOpenCarrySlot();
-                        if(cri < this->level.pc_carry.size())
+                        size_t cri = this->level->getOpenCarrySlot();
+                        if(cri < this->level->pc_carry.size())
                         {
-                            this->level.pc_carry[cri] = iptr;
+                            this->level->pc_carry[cri] = iptr;
                         }
                         else
                         {
-                            this->level.handleItemDrop(*iptr);
+                            this->level->handleItemDrop(*iptr);
                         }
-                        this->level.pc_equipment[d - 1] = nullptr;
+                        this->level->pc_equipment[d - 1] = nullptr;
                         break;
                     }
                     else
@@ -1077,10 +1159,10 @@ int GameState::handle_action_cmd(int action_cmd)
                 while(!(d = UserInput::checkCarrySlot(c)) && !UserInput::checkEscape(c));
                 if(d)
                 {
-                    if(Item* iptr = this->level.pc_carry[d - 1]; iptr)
+                    if(Item* iptr = this->level->pc_carry[d - 1]; iptr)
                     {
-                        this->level.handleItemDrop(*iptr);
-                        this->level.pc_carry[d - 1] = nullptr;
+                        this->level->handleItemDrop(*iptr);
+                        this->level->pc_carry[d - 1] = nullptr;
                         this->map_win.onRefresh(true);  // rerender to show dropped items
                         break;
                     }
@@ -1111,9 +1193,9 @@ int GameState::handle_action_cmd(int action_cmd)
                 while(!(d = UserInput::checkCarrySlot(c)) && !UserInput::checkEscape(c));
                 if(d)
                 {
-                    if(Item* iptr = this->level.pc_carry[d - 1]; iptr)
+                    if(Item* iptr = this->level->pc_carry[d - 1]; iptr)
                     {
-                        this->level.handleItemDelete(d - 1);
+                        this->level->handleItemDelete(d - 1);
                         break;
                     }
                     else
@@ -1157,7 +1239,7 @@ int GameState::handle_action_cmd(int action_cmd)
                 while(!(d = UserInput::checkCarrySlot(c)) && !UserInput::checkEscape(c));
                 if(d)
                 {
-                    if(Item* iptr = this->level.pc_carry[d - 1]; iptr)
+                    if(Item* iptr = this->level->pc_carry[d - 1]; iptr)
                     {
                         NC_PRINT("[%s]", iptr->name.data());
                         this->inv_win.showDescription(iptr);
@@ -1181,10 +1263,10 @@ int GameState::handle_action_cmd(int action_cmd)
         }
         case ACTION_CMD_LOOK:
         {
-            this->level.pc.state.target_pos = this->level.pc.state.pos;
+            this->level->pc.state.target_pos = this->level->pc.state.pos;
             this->state.is_goto_ctrl = true;
             NC_PRINT("Select monster and press \'t\' to display, ESC to cancel");
-            mvwaddch(this->map_win.win, this->level.pc.state.pos.y, this->level.pc.state.pos.x, '*');
+            this->map_win.onGotoMove(this->level->pc.state.pos, this->level->pc.state.pos);
             this->map_win.refresh();
 
             int c;
@@ -1203,7 +1285,7 @@ int GameState::handle_action_cmd(int action_cmd)
                 else
                 if(c == 't')
                 {
-                    Entity* e = DungeonLevel::accessGridElem(this->level.entity_map, this->level.pc.state.target_pos);
+                    Entity* e = this->level->entityAt(this->level->pc.state.target_pos);
                     if(e)
                     {
                         NC_PRINT(
@@ -1249,7 +1331,7 @@ int GameState::handle_mlist_cmd(int mlist_cmd)
         {
             this->state.active_win = GWIN_MLIST;
             this->mlist_win.onShow();
-            NC_PRINT("%lu monster(s) remain.", this->level.npcs_remaining);
+            NC_PRINT("%lu monster(s) remain.", this->level->npcs_remaining);
             break;
         }
         case MLIST_CMD_ESCAPE:
@@ -1290,6 +1372,12 @@ int GameState::handle_dbg_cmd(int dbg_cmd)
             case DBG_CMD_SHOW_TWEIGHTS:
             {
                 this->map_win.changeMap(MapWindow::MAP_FOG + (dbg_cmd - DBG_CMD_TOGGLE_FOG));
+                if(dbg_cmd == DBG_CMD_SHOW_FWEIGHTS || dbg_cmd == DBG_CMD_SHOW_TWEIGHTS)
+                {
+                    NC_PRINT("Cost map updates: %zu requested, %zu avoided",
+                        this->level->cost_updates.requested,
+                        this->level->costUpdatesAvoided() );
+                }
             }
             default: break;
         }
@@ -1304,12 +1392,17 @@ int GameState::handle_dbg_cmd(int dbg_cmd)
 
 // GAMESTATE PUBLIC INTERFACE -----------------------------------------------------------------------------------
 
-void GameState::initRuntimeArgs(uint32_t seed, int nmon)
+void GameState::initRuntimeArgs(uint32_t seed, int nmon, Vec2u16 level_size)
 {
     this->state.seed = seed;
-    this->state.nmon = nmon;
+    this->state.nmon = std::min(nmon, static_cast<int>(DungeonLevel::MAX_NPCS));
 
     this->state.rgen.seed(seed);
+
+    if(level_size.x != this->level->width() || level_size.y != this->level->height())
+    {
+        this->level->resize(level_size.x, level_size.y);
+    }
 }
 
 bool GameState::initMonDescriptions(std::istream& i)
@@ -1324,8 +1417,8 @@ bool GameState::initItemDescriptions(std::istream& i)
 
 bool GameState::initDungeonFile(FILE* f)
 {
-    this->level.setSeed(this->nextSeed());
-    int r = this->level.loadTerrain(f);
+    this->level->setSeed(this->nextSeed());
+    int r = this->level->loadTerrain(f);
     this->initializeEntities();
 
     return static_cast<bool>(r);
@@ -1333,106 +1426,209 @@ bool GameState::initDungeonFile(FILE* f)
 
 bool GameState::initDungeonRandom()
 {
-    this->level.setSeed(this->nextSeed());
-    int r = this->level.generateTerrain();
+    this->level->setSeed(this->nextSeed());
+    int r = this->level->generateTerrain();
     this->initializeEntities();
 
     return static_cast<bool>(r);
 }
 
+bool GameState::generateLevel(
+    DungeonLevel& l,
+    Vec2u16 size,
+    std::mt19937& gen,
+    UniqueAvailability& uniques,
+    ArtifactAvailability& artifacts )
+{
+    if(l.width() != size.x || l.height() != size.y) l.resize(size.x, size.y);
+    else l.reset();
+
+    l.setSeed(static_cast<uint32_t>(gen()));
+    int r = l.generateTerrain();
+    this->initializeEntities(l, gen, uniques, artifacts);
+
+    return static_cast<bool>(r);
+}
+
+void GameState::enterLevel(int32_t depth)
+{
+    std::unique_ptr<DungeonLevel> next;
+    if(!this->level_cache.take(depth, next))
+    {
+    #if DUNGEON_PREGENERATE_LEVELS
+        next = this->takeNextLevel(depth);
+        if(!next)
+    #endif
+        {
+            std::mt19937 gen = this->levelRng(depth);
+            next = std::make_unique<DungeonLevel>();
+            this->generateLevel(
+                *next,
+                Vec2u16{ this->level->width(), this->level->height() },
+                gen,
+                this->unique_availability,
+                this->artifact_availability );
+        }
+    }
+    DungeonLevel& prev = *this->level;
+
+// 1. carry the PC over -- the new level already has its own PC entity placed and queued
+    const Vec2u16 pc_pos = next->pc.state.pos;
+    next->pc = std::move(prev.pc);
+    next->pc.state.pos = pc_pos;
+    next->pc.state.target_pos.assign(0, 0);
+
+    std::swap(next->pc_equipment, prev.pc_equipment);
+    std::swap(next->pc_carry, prev.pc_carry);
+
+// 2. cache the level being left -- the PC entity left behind still marks the stair it was taken from
+    prev.releaseScratch();
+    const size_t bytes = prev.memoryUsage();
+    this->level_cache.insert(this->state.depth, std::move(this->level), bytes);
+
+    this->level = std::move(next);
+    this->state.depth = depth;
+}
+
+#if DUNGEON_PREGENERATE_LEVELS
+void GameState::beginNextLevel()
+{
+    int32_t depth = this->state.depth + 1;
+    if(this->level_cache.contains(depth)) depth = this->state.depth - 1;
+    if(this->level_cache.contains(depth)) return;
+
+    if(this->next_level.job.valid())
+    {
+        if(this->next_level.depth == depth) return;     // still the level to prefetch
+        this->takeNextLevel(depth);                     // discards it
+    }
+
+    this->next_level.depth = depth;
+    this->next_level.rgen = this->levelRng(depth);
+    this->next_level.unique_availability = this->next_level.unique_availability_in = this->unique_availability;
+    this->next_level.artifact_availability = this->next_level.artifact_availability_in = this->artifact_availability;
+
+    const Vec2u16 size{ this->level->width(), this->level->height() };
+    this->next_level.job = std::async(
+        std::launch::async,
+        [this, size]()
+        {
+            this->next_level.level = std::make_unique<DungeonLevel>();
+            return this->generateLevel(
+                *this->next_level.level,
+                size,
+                this->next_level.rgen,
+                this->next_level.unique_availability,
+                this->next_level.artifact_availability );
+        } );
+}
+
+std::unique_ptr<DungeonLevel> GameState::takeNextLevel(int32_t depth)
+{
+    if(!this->next_level.job.valid()) return nullptr;
+
+    this->next_level.job.get();
+    std::unique_ptr<DungeonLevel> next = std::move(this->next_level.level);
+
+    // a level built from stale tables would differ from one built on demand now
+    if( this->next_level.depth != depth ||
+        this->next_level.unique_availability_in != this->unique_availability ||
+        this->next_level.artifact_availability_in != this->artifact_availability ) return nullptr;
+
+    // commit whatever uniques/artifacts the worker spawned
+    this->unique_availability = std::move(this->next_level.unique_availability);
+    this->artifact_availability = std::move(this->next_level.artifact_availability);
+
+    return next;
+}
+#endif
+
 bool GameState::exportDungeonFile(FILE* f)
 {
-    return !this->level.saveTerrain(f);
+    return !this->level->saveTerrain(f);
 }
 
-bool GameState::initializeEntities()
+bool GameState::initializeEntities(
+    DungeonLevel& l,
+    std::mt19937& gen,
+    UniqueAvailability& uniques,
+    ArtifactAvailability& artifacts )
 {
-    #define PC_POS this->level.pc.state.pos
-    #define TERRAIN_MAP this->level.map
-    #define ENTITY_MAP this->level.entity_map
-    #define ITEM_MAP this->level.item_map
+    #define PC_POS l.pc.state.pos
+    #define TERRAIN_MAP l.map
 
-    //  this->level.pc.print(FileDebug::get());
+    //  l.pc.print(FileDebug::get());
     //  FileDebug::get() << "\n\n";
 
 // 1. generate monsters ---------------------------------------------------------------------
     if(this->state.nmon < 0)
     {
-        this->level.npcs_remaining = random_int(DUNGEON_MIN_NUM_MONSTERS, DUNGEON_MAX_NUM_MONSTERS, this->state.rgen);
+        l.npcs_remaining = random_int(DUNGEON_MIN_NUM_MONSTERS, DUNGEON_MAX_NUM_MONSTERS, gen);
     }
     else
     {
-        this->state.rgen.discard(1);
-        this->level.npcs_remaining = static_cast<size_t>(this->state.nmon);
+        gen.discard(1);
+        l.npcs_remaining = static_cast<size_t>(this->state.nmon);
     }
+    l.npcs_remaining = std::min(l.npcs_remaining, DungeonLevel::MAX_NPCS);
 
     std::uniform_int_distribution<size_t>
         mon_desc_idx_distribution{ 0, this->mon_desc.size() - 1 };
     std::uniform_int_distribution<uint8_t>
         rarity_required_distribution{ 0, 99 };
 
-    for(size_t i = 0; i < this->level.npcs_remaining;)
+    for(size_t i = 0; i < l.npcs_remaining;)
     {
-        MonDescription& mdesc = this->mon_desc[mon_desc_idx_distribution(this->state.rgen)];
+        MonDescription& mdesc = this->mon_desc[mon_desc_idx_distribution(gen)];
 
-        auto search = this->unique_availability.find(&mdesc);
-        if(search != this->unique_availability.end() && !search->second) continue;
+        auto search = uniques.find(&mdesc);
+        if(search != uniques.end() && !search->second) continue;
 
-        const uint8_t rr = rarity_required_distribution(this->state.rgen);
+        const uint8_t rr = rarity_required_distribution(gen);
         if(MonDescription::Rarity(mdesc) <= rr) continue;
 
-        this->level.npcs.emplace_back(std::cref(mdesc), std::ref(this->state.rgen));
+        l.npcs.emplace_back(std::cref(mdesc), std::ref(gen));
 
-        if(this->level.npcs.back().config.is_unique)
+        if(l.npcs.back().config.is_unique)
         {
-            this->unique_availability[&mdesc] = false;
+            uniques[&mdesc] = false;
         }
 
-        // this->level.npcs.back().print(FileDebug::get());
+        // l.npcs.back().print(FileDebug::get());
         // FileDebug::get() << "\n\n";
 
         i++;
     }
 
 // 2. assign entity floor positions -------------------------------------------------------
-    if(PC_POS == Vec2u8{ 0, 0 })
+    if(PC_POS == Vec2u16{ 0, 0 })
     {
-        this->level.pc.state.pos = TERRAIN_MAP.randomRoomFloorPos(this->state.rgen);
+        l.pc.state.pos = TERRAIN_MAP.randomRoomFloorPos(gen);
     }
     else
     {
-        this->state.rgen.discard(2);
+        gen.discard(2);
     }
-    DungeonLevel::accessGridElem(ENTITY_MAP, PC_POS) = &this->level.pc;
+    l.setEntityAt(PC_POS, &l.pc);
 
     std::uniform_int_distribution<uint32_t>
         spawn_off_distribution{ 30, 150 };
 
-    uint8_t x = PC_POS.x, y = PC_POS.y;
-    for(size_t m = 0; m < this->level.npcs_remaining; m++)
+    // each spawn lands a random number of free floor cells past the previous one
+    Vec2u16 spawn = PC_POS;
+    for(size_t m = 0; m < l.npcs_remaining; m++)
     {
-        size_t attempts = 0;
-        for( uint32_t trav = spawn_off_distribution(this->state.rgen);
-            trav > 0 && attempts < DUNGEON_TOTAL_CELLS;
-            attempts++ )
-        {
-            // TODO: skip checking border cells
-            x++;
-            y += (x / DUNGEON_X_DIM);
-            x %= DUNGEON_X_DIM;
-            y %= DUNGEON_Y_DIM;
-            trav -= (TERRAIN_MAP.terrain[y][x].type && !ENTITY_MAP[y][x]);
-        }
+        spawn = l.nthFreeFloorAfter(spawn, spawn_off_distribution(gen), l.occupied);
 
-        this->level.npcs[m].state.pos.assign(x, y);
-        ENTITY_MAP[y][x] = &this->level.npcs[m];
+        l.npcs[m].state.pos = spawn;
+        l.setEntityAt(spawn, &l.npcs[m]);
 
         // PRINT_DEBUG( "Initialized monster {%d, %d, (%d, %d), %#x}\n",
         //     me->speed, me->priority, x, y, me->md.stats );
     }
 
 // 3. generate items
-    size_t num_items = random_int(DUNGEON_MIN_NUM_ITEMS, DUNGEON_MAX_NUM_ITEMS, this->state.rgen);
+    size_t num_items = random_int(DUNGEON_MIN_NUM_ITEMS, DUNGEON_MAX_NUM_ITEMS, gen);
     std::uniform_int_distribution<size_t>
         item_desc_idx_distribution{ 0, this->item_desc.size() - 1 };
 
@@ -1441,19 +1637,19 @@ bool GameState::initializeEntities()
 
     for(size_t i = 0; i < num_items;)
     {
-        ItemDescription& idesc = this->item_desc[item_desc_idx_distribution(this->state.rgen)];
+        ItemDescription& idesc = this->item_desc[item_desc_idx_distribution(gen)];
 
-        auto search = this->artifact_availability.find(&idesc);
-        if(search != this->artifact_availability.end() && !search->second) continue;
+        auto search = artifacts.find(&idesc);
+        if(search != artifacts.end() && !search->second) continue;
 
-        const uint8_t rr = rarity_required_distribution(this->state.rgen);
+        const uint8_t rr = rarity_required_distribution(gen);
         if(ItemDescription::Rarity(idesc) <= rr) continue;
 
-        items_buff.push_back(new Item(idesc, this->state.rgen));
+        items_buff.push_back(new Item(idesc, gen));
 
         if(ItemDescription::Artifact(idesc))
         {
-            this->artifact_availability[&idesc] = false;
+            artifacts[&idesc] = false;
         }
 
         // items_buff.back()->print(FileDebug::get());
@@ -1463,39 +1659,27 @@ bool GameState::initializeEntities()
     }
 
 // 4. assign item floor positions
+    BitRows item_cells{ l.width(), l.height() };
     for(size_t i = 0; i < num_items; i++)
     {
-        size_t attempts = 0;
-        for( uint32_t trav = spawn_off_distribution(this->state.rgen);
-            trav > 0 && attempts < DUNGEON_TOTAL_CELLS;
-            attempts++ )
-        {
-            // TODO: skip checking border cells
-            x++;
-            y += (x / DUNGEON_X_DIM);
-            x %= DUNGEON_X_DIM;
-            y %= DUNGEON_Y_DIM;
-            trav -= (TERRAIN_MAP.terrain[y][x].type && !ITEM_MAP[y][x]);
-        }
+        spawn = l.nthFreeFloorAfter(spawn, spawn_off_distribution(gen), item_cells);
 
-        ITEM_MAP[y][x] = items_buff[i];
-
-        // PRINT_DEBUG( "Initialized monster {%d, %d, (%d, %d), %#x}\n",
-        //     me->speed, me->priority, x, y, me->md.stats );
+        l.placeItem(spawn, items_buff[i]);
+        item_cells.set(spawn.y, spawn.x);
     }
 
-// 5. add entities to priority queue
-    this->level.entity_queue.emplace( &this->level.pc, 0, 0 );
-    for(size_t i = 0; i < this->level.npcs.size(); i++)
+// 5. add entities to turn queue
+    l.entity_queue.emplace( &l.pc, 0, 0 );
+    for(size_t i = 0; i < l.npcs.size(); i++)
     {
-        this->level.entity_queue.emplace( &this->level.npcs[i], 0, static_cast<uint8_t>(i + 1) );
+        l.entity_queue.emplace( &l.npcs[i], 0, static_cast<uint32_t>(i + 1) );
     }
 
 // 6. update traversal costmaps
-    this->level.updateCosts(true);
+    l.updateCosts(true);
 
 // 7. update visibility maps
-    this->level.copyVisCells();
+    l.copyVisCells();
 
     return true;
 }
@@ -1508,6 +1692,10 @@ void GameState::run(const std::atomic<bool>& r)
     this->state.active_win = GWIN_MAP;
     this->map_win.onRefresh(true);
 
+#if DUNGEON_PREGENERATE_LEVELS
+    this->beginNextLevel();
+#endif
+
     NC_PRINT("Welcome to the dungeon. Good luck! :)");
 
     while(!status && r) // not won/lost, not exit
@@ -1521,8 +1709,8 @@ void GameState::run(const std::atomic<bool>& r)
             is_currently_map &&
             (status = this->iterate_next_pc()) ) break;  // game done when iterate_next_pc() returns non-zero
 
-        NC_PRINT2("HEALTH: %d", this->level.pc.state.health)
-        NC_PRINT3("SPEED: %d", this->level.getPCSpeed())
+        NC_PRINT2("HEALTH: %d", this->level->pc.state.health)
+        NC_PRINT3("SPEED: %d", this->level->getPCSpeed())
 
     // 3. accept user input
         int c = getch();
@@ -270,7 +270,7 @@ Entity::Entity(Entity::PCGenT x) :
     {
         .name{ "Its you lol" },
         .desc{ "An unlikely hero." },
-        .attack_damage{ { .base{ 2 }, .sides{ 5 }, .rolls{ 1 } }, std::random_device{}() },
+        .attack_damage{ { .base{ 2 }, .sides{ 5 }, .rolls{ 1 } } },
         .speed{ 10 },
         .ability_bits{ 0 },
         .color{ DisplayColor::WHITE },
@@ -145,8 +145,8 @@ public:
 
     struct
     {
-        Vec2u8 pos{ 0, 0 };
-        Vec2u8 target_pos{ 0, 0 };
+        Vec2u16 pos{ 0, 0 };
+        Vec2u16 target_pos{ 0, 0 };
 
         int32_t health{ 0 };
     }
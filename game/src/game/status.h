@@ -12,13 +12,13 @@
     refresh();
 
 #define NC_PRINT2(...) \
-    move((DUNGEON_Y_DIM + 1), 0); \
+    move((DUNGEON_MAP_WIN_Y_OFF + DUNGEON_MAP_WIN_Y_DIM), 0); \
     clrtoeol(); \
-    mvprintw((DUNGEON_Y_DIM + 1), 0, __VA_ARGS__); \
+    mvprintw((DUNGEON_MAP_WIN_Y_OFF + DUNGEON_MAP_WIN_Y_DIM), 0, __VA_ARGS__); \
     refresh();
 
 #define NC_PRINT3(...) \
-    move((DUNGEON_Y_DIM + 2), 0); \
+    move((DUNGEON_MAP_WIN_Y_OFF + DUNGEON_MAP_WIN_Y_DIM + 1), 0); \
     clrtoeol(); \
-    mvprintw((DUNGEON_Y_DIM + 2), 0, __VA_ARGS__); \
+    mvprintw((DUNGEON_MAP_WIN_Y_OFF + DUNGEON_MAP_WIN_Y_DIM + 1), 0, __VA_ARGS__); \
     refresh();
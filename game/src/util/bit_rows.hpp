@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+/* Runtime sized stack of bit rows for bitboard style grid algorithms. Each row
+ * is spread over as many 64-bit words as its width needs, and bit i of a row
+ * corresponds to column i. Rows are exposed as word pointers so that kernels
+ * can combine several rows in a single pass. Bits past the width in the last
+ * word are never set by set(), so masking a computed row against one that was
+ * built with set() clears them. */
+class BitRows
+{
+public:
+    inline BitRows() = default;
+    inline BitRows(size_t bits, size_t rows) { this->resize(bits, rows); }
+    inline ~BitRows() = default;
+
+public:
+    // previous contents are discarded
+    inline void resize(size_t bits, size_t rows)
+    {
+        this->n_words = (bits + 63) / 64;
+        this->n_rows = rows;
+        this->bits.assign(this->n_words * rows, 0);
+    }
+
+    inline size_t rowWords() const { return this->n_words; }
+    inline size_t rows() const { return this->n_rows; }
+
+    inline uint64_t* operator[](size_t r) { return this->bits.data() + r * this->n_words; }
+    inline const uint64_t* operator[](size_t r) const { return this->bits.data() + r * this->n_words; }
+
+    inline void clear() { this->bits.assign(this->bits.size(), 0); }
+    inline void clearRow(size_t r)
+    {
+        uint64_t* w = (*this)[r];
+        for(size_t i = 0; i < this->n_words; i++) w[i] = 0;
+    }
+
+    inline void set(size_t r, size_t i) { (*this)[r][i / 64] |= (uint64_t{ 1 } << (i % 64)); }
+    inline void reset(size_t r, size_t i) { (*this)[r][i / 64] &= ~(uint64_t{ 1 } << (i % 64)); }
+    inline bool test(size_t r, size_t i) const { return ((*this)[r][i / 64] >> (i % 64)) & 0x1; }
+
+    // sets (or clears) columns [i0, i1] of row r
+    inline void assignRange(size_t r, size_t i0, size_t i1, bool v)
+    {
+        uint64_t* row = (*this)[r];
+        for(size_t w = i0 / 64; w <= i1 / 64; w++)
+        {
+            const uint64_t m = rangeMask(w, i0, i1);
+            row[w] = v ? (row[w] | m) : (row[w] & ~m);
+        }
+    }
+    // true if any bit in columns [i0, i1] of rows [r0, r1] is set
+    inline bool anyInRect(size_t r0, size_t r1, size_t i0, size_t i1) const
+    {
+        for(size_t r = r0; r <= r1; r++)
+        {
+            const uint64_t* row = (*this)[r];
+            for(size_t w = i0 / 64; w <= i1 / 64; w++)
+            {
+                if(row[w] & rangeMask(w, i0, i1)) return true;
+            }
+        }
+        return false;
+    }
+
+    // bits of word w that fall within columns [i0, i1]
+    static inline uint64_t rangeMask(size_t w, size_t i0, size_t i1)
+    {
+        const uint64_t
+            lo = (w == i0 / 64) ? (~uint64_t{ 0 } << (i0 % 64)) : ~uint64_t{ 0 },
+            hi = (w == i1 / 64) ? (~uint64_t{ 0 } >> (63 - i1 % 64)) : ~uint64_t{ 0 };
+        return lo & hi;
+    }
+    // invokes f(column) for every set bit of a row, in increasing order
+    template<typename F>
+    static inline void forEachSet(const uint64_t* row, size_t n_words, F&& f)
+    {
+        for(size_t i = 0; i < n_words; i++)
+        {
+            for(uint64_t b = row[i]; b; b &= (b - 1))
+            {
+                f(i * 64 + static_cast<size_t>(__builtin_ctzll(b)));
+            }
+        }
+    }
+
+protected:
+    std::vector<uint64_t> bits;
+    size_t n_words{ 0 }, n_rows{ 0 };
+
+};
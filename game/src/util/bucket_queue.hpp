@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+/* Monotone bucket queue (Dial's algorithm) for small-integer keys. Items are
+ * identified by a dense index and linked into a circular array of buckets, so
+ * pushes, decrease-keys, and pops are O(1) amortized with no allocations once
+ * the queue has been sized. Keys must never decrease below the last popped
+ * key, and no queued key may exceed the last popped key by more than the
+ * maximum weight that the queue was reset with. */
+class BucketQueue
+{
+public:
+    static constexpr uint32_t NIL = 0xFFFFFFFF;
+
+public:
+    inline BucketQueue() = default;
+    inline BucketQueue(size_t n_items, uint32_t max_weight, uint32_t base_key = 0)
+    {
+        this->reset(n_items, max_weight, base_key);
+    }
+    inline ~BucketQueue() = default;
+
+public:
+    inline void reset(size_t n_items, uint32_t max_weight, uint32_t base_key = 0)
+    {
+        // drain anything left over from an early exit so that every key reads as unqueued
+        for(uint32_t& head : this->heads)
+        {
+            for(uint32_t i = head; i != NIL; i = this->next[i]) this->keys[i] = NIL;
+        }
+        if(this->next.size() < n_items)
+        {
+            this->next.resize(n_items);
+            this->prev.resize(n_items);
+            this->keys.resize(n_items, NIL);
+        }
+        this->heads.assign(max_weight + 1, NIL);
+
+        this->cursor = base_key;
+        this->count = 0;
+    }
+
+    inline bool empty() const { return !this->count; }
+    inline size_t size() const { return this->count; }
+    inline bool contains(uint32_t idx) const { return this->keys[idx] != NIL; }
+
+    // pushing into an empty queue, or below the cursor, rebases the queue to the new key
+    inline void push(uint32_t idx, uint32_t key)
+    {
+        if(!this->count || key < this->cursor) this->cursor = key;
+
+        uint32_t& head = this->heads[key % this->heads.size()];
+
+        this->keys[idx] = key;
+        this->prev[idx] = NIL;
+        this->next[idx] = head;
+        if(head != NIL) this->prev[head] = idx;
+        head = idx;
+
+        this->count++;
+    }
+    inline void decrease(uint32_t idx, uint32_t key)
+    {
+        this->unlink(idx);
+        this->push(idx, key);
+    }
+    // returns the smallest queued key, or NIL if the queue is empty
+    inline uint32_t minKey()
+    {
+        if(!this->count) return NIL;
+
+        while(this->heads[this->cursor % this->heads.size()] == NIL) this->cursor++;
+        return this->cursor;
+    }
+    // returns NIL if the queue is empty
+    inline uint32_t pop()
+    {
+        if(!this->count) return NIL;
+
+        uint32_t* head;
+        while(*(head = &this->heads[this->cursor % this->heads.size()]) == NIL) this->cursor++;
+
+        const uint32_t idx = *head;
+        this->unlink(idx);
+        return idx;
+    }
+
+protected:
+    inline void unlink(uint32_t idx)
+    {
+        const uint32_t p = this->prev[idx], n = this->next[idx];
+
+        if(p != NIL) this->next[p] = n;
+        else this->heads[this->keys[idx] % this->heads.size()] = n;
+        if(n != NIL) this->prev[n] = p;
+
+        this->keys[idx] = NIL;
+        this->count--;
+    }
+
+protected:
+    std::vector<uint32_t> heads;
+    std::vector<uint32_t> next, prev;
+    std::vector<uint32_t> keys;
+
+    uint32_t cursor{ 0 };
+    size_t count{ 0 };
+
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+/* Runtime sized 2D grid stored as a single contiguous row-major allocation.
+ * Indexing by row returns a pointer to the start of that row, so cells are
+ * still accessed as grid[y][x] like a fixed size 2D array. */
+template<typename T>
+class Grid
+{
+public:
+    inline Grid() = default;
+    inline Grid(size_t w, size_t h, const T& v = T{})
+    {
+        this->resize(w, h, v);
+    }
+    inline ~Grid() = default;
+
+public:
+    // previous contents are discarded
+    inline void resize(size_t w, size_t h, const T& v = T{})
+    {
+        this->w = w;
+        this->h = h;
+        this->cells.assign(w * h, v);
+    }
+    inline void fill(const T& v)
+    {
+        std::fill(this->cells.begin(), this->cells.end(), v);
+    }
+
+    inline size_t width() const { return this->w; }
+    inline size_t height() const { return this->h; }
+    inline size_t size() const { return this->cells.size(); }
+    inline size_t bytes() const { return this->cells.size() * sizeof(T); }
+
+    inline T* data() { return this->cells.data(); }
+    inline const T* data() const { return this->cells.data(); }
+
+    inline T* operator[](size_t y) { return this->cells.data() + y * this->w; }
+    inline const T* operator[](size_t y) const { return this->cells.data() + y * this->w; }
+
+protected:
+    std::vector<T> cells;
+    size_t w{ 0 }, h{ 0 };
+
+};
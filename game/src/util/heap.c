@@ -110,15 +110,79 @@ void print_heap_node_list(HeapNode *n)
     printf("\n");
 }
 
+int heap_arena_init(HeapNodeArena *a, uint32_t capacity)
+{
+    a->used = 0;
+    a->spilled = 0;
+    a->capacity = 0;
+    if(!(a->nodes = malloc(capacity * sizeof (*a->nodes)))) return 1;
+    a->capacity = capacity;
+
+    return 0;
+}
+
+void heap_arena_delete(HeapNodeArena *a)
+{
+    free(a->nodes);
+    a->nodes = NULL;
+    a->capacity = a->used = a->spilled = 0;
+}
+
+static HeapNode *heap_node_alloc(Heap *h)
+{
+    HeapNode *n;
+
+    if(h->arena && h->arena->used < h->arena->capacity)
+    {
+        n = &h->arena->nodes[h->arena->used++];
+        memset(n, 0, sizeof (*n));
+    }
+    else
+    {
+        assert((n = calloc(1, sizeof (*n))));
+        if(h->arena)
+        {
+            h->arena->spilled++;
+        }
+    }
+
+    return n;
+}
+
+static void heap_node_free(Heap *h, HeapNode *n)
+{
+    if( !h->arena ||
+        n < h->arena->nodes ||
+        n >= h->arena->nodes + h->arena->capacity )
+    {
+        free(n);
+    }
+}
+
 void heap_init(
     Heap *h,
     int32_t (*compare)(const void *key, const void *with),
     void (*datum_delete)(void *) )
+{
+    heap_init_arena(h, compare, datum_delete, NULL);
+}
+
+void heap_init_arena(
+    Heap *h,
+    int32_t (*compare)(const void *key, const void *with),
+    void (*datum_delete)(void *),
+    HeapNodeArena *arena )
 {
     h->min = NULL;
     h->size = 0;
     h->compare = compare;
     h->datum_delete = datum_delete;
+    h->arena = arena;
+    if(arena)
+    {
+        arena->used = 0;
+        arena->spilled = 0;
+    }
 }
 
 void heap_node_delete(Heap *h, HeapNode *hn)
@@ -137,14 +201,15 @@ void heap_node_delete(Heap *h, HeapNode *hn)
         {
             h->datum_delete(hn->datum);
         }
-        free(hn);
+        heap_node_free(h, hn);
         hn = next;
     }
 }
 
 void heap_delete(Heap *h)
 {
-    if(h->min)
+    /* arena backed nodes with no data to delete can just be abandoned */
+    if(h->min && (!h->arena || h->datum_delete || h->arena->spilled))
     {
         heap_node_delete(h, h->min);
     }
@@ -152,13 +217,14 @@ void heap_delete(Heap *h)
     h->size = 0;
     h->compare = NULL;
     h->datum_delete = NULL;
+    h->arena = NULL;
 }
 
 HeapNode *heap_insert(Heap *h, void *v)
 {
     HeapNode *n;
 
-    assert((n = calloc(1, sizeof (*n))));
+    n = heap_node_alloc(h);
     n->datum = v;
 
     if(h->min)
@@ -262,7 +328,7 @@ void *heap_remove_min(Heap *h)
         v = h->min->datum;
         if(h->size == 1)
         {
-            free(h->min);
+            heap_node_free(h, h->min);
             h->min = NULL;
         }
         else
@@ -280,7 +346,7 @@ void *heap_remove_min(Heap *h)
             n = h->min;
             remove_heap_node_from_list(n);
             h->min = n->next;
-            free(n);
+            heap_node_free(h, n);
 
             heap_consolidate(h);
         }
@@ -13,19 +13,41 @@ extern "C" {
 struct heap_node;
 typedef struct heap_node HeapNode;
 
+/* Preallocated block of nodes that a heap can draw from instead of calling
+ * malloc per insert. An arena backs at most one heap at a time -- it is reset
+ * in O(1) by heap_init_arena(), and nodes are simply abandoned on removal.
+ * Inserts past capacity fall back to the system allocator. */
+typedef struct heap_node_arena
+{
+    HeapNode *nodes;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t spilled;   /* nodes that had to be malloc'd */
+}
+HeapNodeArena;
+
 typedef struct heap
 {
     HeapNode *min;
     uint32_t size;
     int32_t (*compare)(const void *key, const void *with);
     void (*datum_delete)(void *);
+    HeapNodeArena *arena;
 }
 Heap;
 
+int heap_arena_init(HeapNodeArena *a, uint32_t capacity);
+void heap_arena_delete(HeapNodeArena *a);
+
 void heap_init(
     Heap *h,
     int32_t (*compare)(const void *key, const void *with),
     void (*datum_delete)(void *) );
+void heap_init_arena(
+    Heap *h,
+    int32_t (*compare)(const void *key, const void *with),
+    void (*datum_delete)(void *),
+    HeapNodeArena *arena );
 void heap_delete(Heap *h);
 HeapNode *heap_insert(Heap *h, void *v);
 void *heap_peek_min(Heap *h);
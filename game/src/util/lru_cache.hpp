@@ -0,0 +1,75 @@
+#pragma once
+
+#include <unordered_map>
+#include <cstddef>
+#include <utility>
+#include <list>
+
+
+/* Least recently used cache with a budget on the summed cost (ex. bytes) of
+ * its entries. Inserting past the budget evicts from the least recently used
+ * end, which may include the new entry itself if it alone exceeds the budget.
+ * Entries are handed back (and removed) by take(). */
+template<typename K, typename V>
+class LRUCache
+{
+public:
+    inline LRUCache(size_t budget = 0) : budget{ budget } {}
+    inline ~LRUCache() = default;
+
+public:
+    inline size_t size() const { return this->entries.size(); }
+    inline size_t cost() const { return this->total_cost; }
+    inline size_t evictions() const { return this->num_evicted; }
+    inline bool contains(const K& k) const { return this->index.count(k); }
+
+    // replaces any entry with the same key
+    void insert(const K& k, V&& v, size_t cost)
+    {
+        this->erase(k);
+
+        this->entries.push_front(Entry{ k, std::move(v), cost });
+        this->index[k] = this->entries.begin();
+        this->total_cost += cost;
+
+        while(this->total_cost > this->budget && !this->entries.empty())
+        {
+            this->index.erase(this->entries.back().key);
+            this->total_cost -= this->entries.back().cost;
+            this->entries.pop_back();
+            this->num_evicted++;
+        }
+    }
+    bool take(const K& k, V& v)
+    {
+        auto search = this->index.find(k);
+        if(search == this->index.end()) return false;
+
+        v = std::move(search->second->value);
+        this->erase(k);
+
+        return true;
+    }
+    void erase(const K& k)
+    {
+        auto search = this->index.find(k);
+        if(search == this->index.end()) return;
+
+        this->total_cost -= search->second->cost;
+        this->entries.erase(search->second);
+        this->index.erase(search);
+    }
+
+protected:
+    struct Entry
+    {
+        K key;
+        V value;
+        size_t cost;
+    };
+
+    std::list<Entry> entries;   // most recently inserted first
+    std::unordered_map<K, typename std::list<Entry>::iterator> index;
+    size_t budget, total_cost{ 0 }, num_evicted{ 0 };
+
+};
@@ -12,9 +12,6 @@
 #define MIN_CACHED(a, b) ({ decltype(a) _a = (a); decltype(b) _b = (b); (_a < _b) ? _a : _b; })
 #define MAX_CACHED(a, b) ({ decltype(a) _a = (a); decltype(b) _b = (b); (_a > _b) ? _a : _b; })
 
-#define RANDOM_IN_RANGE(min, max) ((min) + (decltype(min))(rand() % ((max) - (min) + 1)))
-#define RANDOM_IN_RANGE_CACHED(min, max) ({ decltype(min) _m = (min); decltype(max) _M = (max); (_m + (decltype(_m))(rand() % (_M - _m + 1))); })
-
 #define NUM_BITS32_UCOUNT(n) \
     ((n) - (((n) >> 1) & 033333333333) - (((n) >> 2) & 011111111111))
 #define NUM_BITS32(n) \
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+/* Runtime sized 2D grid of small unsigned values, packed Bits per cell. Cells
+ * never straddle a word boundary, so each access is a single load, shift,
+ * and mask. */
+template<uint32_t Bits>
+class PackedGrid
+{
+    static_assert(Bits > 0 && Bits <= 16);
+
+public:
+    static constexpr uint32_t CELLS_PER_WORD = 32 / Bits;
+    static constexpr uint32_t CELL_MASK = (1U << Bits) - 1;
+
+public:
+    inline PackedGrid() = default;
+    inline PackedGrid(size_t w, size_t h) { this->resize(w, h); }
+    inline ~PackedGrid() = default;
+
+public:
+    // previous contents are discarded
+    inline void resize(size_t w, size_t h)
+    {
+        this->w = w;
+        this->words.assign((w * h + CELLS_PER_WORD - 1) / CELLS_PER_WORD, 0);
+    }
+
+    inline uint32_t get(size_t x, size_t y) const
+    {
+        const size_t i = y * this->w + x;
+        return (this->words[i / CELLS_PER_WORD] >> ((i % CELLS_PER_WORD) * Bits)) & CELL_MASK;
+    }
+    inline void set(size_t x, size_t y, uint32_t v)
+    {
+        const size_t i = y * this->w + x;
+        const uint32_t shift = (i % CELLS_PER_WORD) * Bits;
+        uint32_t& w = this->words[i / CELLS_PER_WORD];
+
+        w = (w & ~(CELL_MASK << shift)) | ((v & CELL_MASK) << shift);
+    }
+    inline void fill(uint32_t v)
+    {
+        uint32_t w = 0;
+        for(uint32_t i = 0; i < CELLS_PER_WORD; i++) w |= (v & CELL_MASK) << (i * Bits);
+        this->words.assign(this->words.size(), w);
+    }
+
+    inline size_t bytes() const { return this->words.size() * sizeof(uint32_t); }
+
+protected:
+    std::vector<uint32_t> words;
+    size_t w{ 0 };
+
+};
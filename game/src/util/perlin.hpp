@@ -1,4 +1,36 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 float perlin2f(float x, float y);
 double perlin2d(double x, double y);
+
+/* Batched evaluation over evenly spaced samples, bit-identical to calling the
+ * scalar functions on the same coordinates. Sample i of a row is taken at
+ * x = (F)(x_begin + i) * x_scale + x_offset (and row j of a grid at
+ * y = (F)(y_begin + j) * y_scale + y_offset), matching how callers usually
+ * build coordinates from cell indices. Indices must stay below 2^24, and
+ * coordinates within +/-2^31. */
+void perlin2f_row(float* out, size_t n, size_t x_begin, float x_scale, float x_offset, float y);
+void perlin2d_row(double* out, size_t n, size_t x_begin, double x_scale, double x_offset, double y);
+void perlin2f_grid(
+    float* out, size_t stride, size_t w, size_t h,
+    size_t x_begin, size_t y_begin,
+    float x_scale, float y_scale,
+    float x_offset, float y_offset );
+void perlin2d_grid(
+    double* out, size_t stride, size_t w, size_t h,
+    size_t x_begin, size_t y_begin,
+    double x_scale, double y_scale,
+    double x_offset, double y_offset );
+
+/* Fractal (fBm) sum of octaves -- octave k samples (x, y) * lacunarity^k with
+ * weight gain^k. All octaves are accumulated in registers per batch of lanes.
+ * A single octave is identical to the plain row. */
+void perlin2f_fbm_row(
+    float* out, size_t n, size_t x_begin, float x_scale, float x_offset, float y,
+    uint32_t octaves, float lacunarity = 2.f, float gain = 0.5f );
+void perlin2d_fbm_row(
+    double* out, size_t n, size_t x_begin, double x_scale, double x_offset, double y,
+    uint32_t octaves, double lacunarity = 2., double gain = 0.5 );
@@ -3,9 +3,70 @@
 #include <type_traits>
 #include <iostream>
 #include <cstdlib>
+#include <cstdint>
 #include <random>
 
 
+/* PCG32 (XSH RR variant, 64 bit state). The stream selects one of 2^63
+ * distinct sequences for the same seed, so parallel work can split off a
+ * generator per task -- seeded from one draw of a shared generator -- without
+ * touching (or ordering on) the shared one. Satisfies the
+ * UniformRandomBitGenerator requirements for use with the std distributions. */
+class Pcg32
+{
+public:
+    using result_type = uint32_t;
+
+    static inline constexpr uint64_t DEFAULT_SEED = 0x853c49e6748fea9bULL;
+
+public:
+    inline Pcg32(uint64_t seed = DEFAULT_SEED, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    inline void seed(uint64_t seed, uint64_t stream = 0)
+    {
+        this->state = 0;
+        this->inc = (stream << 1) | 1;
+        (*this)();
+        this->state += seed;
+        (*this)();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    inline result_type operator()()
+    {
+        const uint64_t s = this->state;
+        this->state = s * 6364136223846793005ULL + this->inc;
+        const uint32_t x = static_cast<uint32_t>(((s >> 18) ^ s) >> 27);
+        const uint32_t rot = static_cast<uint32_t>(s >> 59);
+        return (x >> rot) | (x << ((32 - rot) & 31));
+    }
+    inline uint64_t next64() { return (static_cast<uint64_t>((*this)()) << 32) | (*this)(); }
+
+    // uniform in [0, n) for n > 0 -- multiply-shift, only rejecting (and dividing) on the biased sliver
+    inline uint32_t bounded(uint32_t n)
+    {
+        uint64_t m = static_cast<uint64_t>((*this)()) * n;
+        if(static_cast<uint32_t>(m) < n)
+        {
+            const uint32_t t = (0u - n) % n;
+            while(static_cast<uint32_t>(m) < t) m = static_cast<uint64_t>((*this)()) * n;
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+    // uniform in [lo, hi]
+    inline int32_t range(int32_t lo, int32_t hi)
+    {
+        return lo + static_cast<int32_t>(this->bounded(static_cast<uint32_t>(hi - lo) + 1));
+    }
+
+protected:
+    uint64_t state, inc;
+
+};
+
+
 template<typename I = uint32_t, typename G = std::mt19937>
 static inline I random_int(I min, I max, G& gen)
 {
@@ -45,6 +106,14 @@ public:
 
         return x;
     }
+    inline int32_t roll(Pcg32& gen) const
+    {
+        if(!this->sides) return this->base;
+        int32_t x = this->base;
+        for(uint32_t r = 0; r < this->rolls; r++) x += 1 + static_cast<int32_t>(gen.bounded(this->sides));
+
+        return x;
+    }
 
 };
 
@@ -80,6 +149,13 @@ public:
         for(uint32_t r = 0; r < this->rolls; r++) x += static_cast<int32_t>(this->distribution(generator));
         return x;
     }
+    inline int32_t roll(Pcg32& generator)
+    {
+        const uint32_t lo = this->distribution.a(), n = this->distribution.b() - lo + 1;
+        int32_t x = this->base;
+        for(uint32_t r = 0; r < this->rolls; r++) x += static_cast<int32_t>(lo + generator.bounded(n));
+        return x;
+    }
 
     int32_t roll();
     int32_t rollArg(RollNumArgT n);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+
+
+/* Recursive shadowcasting field of view. Scans the 8 octants around the origin
+ * row by row, narrowing the visible slope range at each opaque cell and
+ * recursing into the gaps between them, so every cell is visited at most once
+ * per octant and only cells that are actually visible get visited at all.
+ * opaque(x, y) must return true for cells outside of the grid, and mark(x, y)
+ * is invoked for each visible cell (opaque ones included, the origin first).
+ * Cells within radius are those with dx^2 + dy^2 <= r^2 + r, a circle of
+ * radius r + 1/2 rounded to the grid. */
+
+namespace shadowcast_impl
+{
+    static inline constexpr int8_t OCTANTS[8][4] =   // (xx, xy, yx, yy)
+    {
+        {  1,  0,  0,  1 },
+        {  0,  1,  1,  0 },
+        {  0, -1,  1,  0 },
+        { -1,  0,  0,  1 },
+        { -1,  0,  0, -1 },
+        {  0, -1, -1,  0 },
+        {  0,  1, -1,  0 },
+        {  1,  0,  0, -1 },
+    };
+
+    template<typename O, typename M>
+    void castOctant(
+        int32_t ox, int32_t oy, int32_t row,
+        double start, double end,
+        int32_t radius, int64_t radius_sq,
+        const int8_t* t, O& opaque, M& mark )
+    {
+        if(start < end) return;
+
+        double next_start = start;
+        for(int32_t j = row; j <= radius; j++)
+        {
+            bool blocked = false;
+            for(int32_t dx = -j; dx <= 0; dx++)
+            {
+                const int32_t dy = -j;
+                const double
+                    l_slope = (dx - 0.5) / (dy + 0.5),
+                    r_slope = (dx + 0.5) / (dy - 0.5);
+
+                if(start < r_slope) continue;
+                if(end > l_slope) break;
+
+                const int32_t
+                    x = ox + dx * t[0] + dy * t[1],
+                    y = oy + dx * t[2] + dy * t[3];
+                const bool o = opaque(x, y);
+
+                if(static_cast<int64_t>(dx) * dx + static_cast<int64_t>(dy) * dy <= radius_sq)
+                {
+                    mark(x, y);
+                }
+
+                if(blocked)
+                {
+                    if(o)
+                    {
+                        next_start = r_slope;
+                    }
+                    else
+                    {
+                        blocked = false;
+                        start = next_start;
+                    }
+                }
+                else
+                if(o && j < radius)
+                {
+                    blocked = true;
+                    castOctant(ox, oy, j + 1, start, l_slope, radius, radius_sq, t, opaque, mark);
+                    next_start = r_slope;
+                }
+            }
+            if(blocked) break;
+        }
+    }
+}
+
+template<typename O, typename M>
+void shadowcast(int32_t ox, int32_t oy, int32_t radius, O&& opaque, M&& mark)
+{
+    mark(ox, oy);
+
+    const int64_t radius_sq = static_cast<int64_t>(radius) * radius + radius;
+    for(const auto& t : shadowcast_impl::OCTANTS)
+    {
+        shadowcast_impl::castOctant(ox, oy, 1, 1., 0., radius, radius_sq, t, opaque, mark);
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+
+/* Fixed set of worker threads for fork-join loops. parallelFor() hands out
+ * chunks of the index range to the workers and the calling thread alike, and
+ * returns once every index has been processed. With no workers (ex. on a
+ * single core) the loop simply runs inline. Only one loop runs at a time. */
+class ThreadPool
+{
+public:
+    inline ThreadPool(size_t n_threads = std::thread::hardware_concurrency())
+    {
+        // the caller of parallelFor() does its share of the work too
+        for(size_t i = 1; i < n_threads; i++)
+        {
+            this->workers.emplace_back([this](){ this->workerLoop(); });
+        }
+    }
+    inline ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ this->mtx };
+            this->exiting = true;
+        }
+        this->wake.notify_all();
+        for(std::thread& t : this->workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+    inline size_t size() const { return this->workers.size() + 1; }
+
+    // invokes f(i) for every i in [0, n), in no particular order or thread
+    template<typename F>
+    void parallelFor(size_t n, F&& f, size_t chunk = 16)
+    {
+        if(this->workers.empty() || n <= chunk)
+        {
+            for(size_t i = 0; i < n; i++) f(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{ this->mtx };
+            this->job = [&f](size_t i){ f(i); };
+            this->job_n = n;
+            this->job_chunk = chunk;
+            this->next.store(0, std::memory_order_relaxed);
+            this->busy = this->workers.size();
+            this->generation++;
+        }
+        this->wake.notify_all();
+
+        this->runChunks();
+
+        std::unique_lock<std::mutex> lock{ this->mtx };
+        this->done.wait(lock, [this](){ return !this->busy; });
+        this->job = nullptr;
+    }
+
+protected:
+    void runChunks()
+    {
+        for(size_t i; (i = this->next.fetch_add(this->job_chunk, std::memory_order_relaxed)) < this->job_n;)
+        {
+            const size_t end = std::min(i + this->job_chunk, this->job_n);
+            for(; i < end; i++) this->job(i);
+        }
+    }
+    void workerLoop()
+    {
+        uint64_t seen = 0;
+        for(;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock{ this->mtx };
+                this->wake.wait(lock, [&](){ return this->exiting || this->generation != seen; });
+                if(this->exiting) return;
+                seen = this->generation;
+            }
+
+            this->runChunks();
+
+            std::lock_guard<std::mutex> lock{ this->mtx };
+            if(!--this->busy) this->done.notify_one();
+        }
+    }
+
+protected:
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable wake, done;
+
+    std::function<void(size_t)> job;
+    size_t job_n{ 0 }, job_chunk{ 1 }, busy{ 0 };
+    std::atomic<size_t> next{ 0 };
+    uint64_t generation{ 0 };
+    bool exiting{ false };
+
+};
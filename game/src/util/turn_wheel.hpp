@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/* Timing wheel for turn scheduling. Drop-in for a std::priority_queue of nodes
+ * with a next_turn key and an operator< that orders them like the queue would
+ * (the "largest" node is served first). Nodes due within 2^SLOT_BITS turns of
+ * the cursor are filed in the slot for their turn, so pushes and pops only
+ * touch one small slot (kept as a heap for nodes sharing a turn) plus an
+ * occupancy bitmask that finds the next non-empty slot. Nodes further out, or
+ * behind the cursor, wait in an overflow heap that is compared against on
+ * every pop and drained into the wheel whenever the wheel runs empty. */
+template<typename T, size_t SLOT_BITS = 10>
+class TurnWheel
+{
+    static_assert(SLOT_BITS >= 6, "Wheel must span at least one occupancy word");
+
+public:
+    static constexpr size_t SLOTS = size_t{ 1 } << SLOT_BITS;
+    static constexpr size_t SLOT_MASK = SLOTS - 1;
+
+public:
+    inline TurnWheel() : slots(SLOTS), occupancy(SLOTS / 64, 0) {}
+    inline ~TurnWheel() = default;
+
+public:
+    inline bool empty() const { return !this->count; }
+    inline size_t size() const { return this->count; }
+
+    // slot storage is kept so that a refilled wheel does not reallocate
+    void clear()
+    {
+        for(std::vector<T>& s : this->slots) s.clear();
+        std::fill(this->occupancy.begin(), this->occupancy.end(), 0);
+        this->overflow.clear();
+        this->cursor = 0;
+        this->in_wheel = 0;
+        this->count = 0;
+    }
+
+    void push(const T& v)
+    {
+        if(!this->in_wheel)
+        {
+            this->rebase(
+                this->overflow.empty() ? v.next_turn :
+                    std::min(v.next_turn, this->overflow.front().next_turn) );
+        }
+        this->file(v);
+        this->count++;
+    }
+    template<typename... Args>
+    inline void emplace(Args&&... args)
+    {
+        this->push(T{ std::forward<Args>(args)... });
+    }
+
+    // non-const since finding the next due slot advances the cursor
+    inline const T& top()
+    {
+        bool from_overflow;
+        return this->next(from_overflow);
+    }
+    void pop()
+    {
+        bool from_overflow;
+        this->next(from_overflow);
+
+        std::vector<T>& h = from_overflow ? this->overflow : this->slots[this->cursor & SLOT_MASK];
+        std::pop_heap(h.begin(), h.end());
+        h.pop_back();
+        this->count--;
+
+        if(!from_overflow)
+        {
+            if(h.empty())
+            {
+                const size_t s = this->cursor & SLOT_MASK;
+                this->occupancy[s / 64] &= ~(uint64_t{ 1 } << (s % 64));
+            }
+            if(!--this->in_wheel && !this->overflow.empty())
+            {
+                this->rebase(this->overflow.front().next_turn);
+            }
+        }
+    }
+
+protected:
+    // places a node in its slot, or in the overflow heap if it is outside the window
+    void file(const T& v)
+    {
+        if(v.next_turn < this->cursor || v.next_turn - this->cursor > SLOT_MASK)
+        {
+            this->overflow.push_back(v);
+            std::push_heap(this->overflow.begin(), this->overflow.end());
+            return;
+        }
+
+        const size_t s = v.next_turn & SLOT_MASK;
+        std::vector<T>& h = this->slots[s];
+        h.push_back(v);
+        std::push_heap(h.begin(), h.end());
+        this->occupancy[s / 64] |= (uint64_t{ 1 } << (s % 64));
+        this->in_wheel++;
+    }
+    // moves an empty wheel's cursor and pulls in overflow nodes that now fit
+    void rebase(size_t turn)
+    {
+        this->cursor = turn;
+        while(!this->overflow.empty() &&
+            this->overflow.front().next_turn >= this->cursor &&
+            this->overflow.front().next_turn - this->cursor <= SLOT_MASK)
+        {
+            const T v = this->overflow.front();
+            std::pop_heap(this->overflow.begin(), this->overflow.end());
+            this->overflow.pop_back();
+            this->file(v);
+        }
+    }
+    // advances the cursor to the first occupied slot and returns the node to serve
+    const T& next(bool& from_overflow)
+    {
+        from_overflow = !this->in_wheel;
+        if(from_overflow) return this->overflow.front();
+
+        // 1. SCAN OCCUPANCY WORDS STARTING AT THE CURSOR'S SLOT, WRAPPING ONCE
+        const size_t s = this->cursor & SLOT_MASK, n_words = this->occupancy.size();
+        size_t slot = s;
+        for(size_t k = 0; k <= n_words; k++)
+        {
+            const size_t w = (s / 64 + k) % n_words;
+            uint64_t bits = this->occupancy[w];
+            if(k == 0) bits &= (~uint64_t{ 0 } << (s % 64));
+            else if(k == n_words) bits &= ~(~uint64_t{ 0 } << (s % 64));
+
+            if(bits)
+            {
+                slot = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                break;
+            }
+        }
+        this->cursor += (slot - s) & SLOT_MASK;
+
+        // 2. OVERFLOW NODES MAY STILL BE DUE FIRST
+        const T& w = this->slots[slot].front();
+        from_overflow = !this->overflow.empty() && (w < this->overflow.front());
+        return from_overflow ? this->overflow.front() : w;
+    }
+
+protected:
+    std::vector<std::vector<T>> slots;      // each is a heap of nodes due on the same turn
+    std::vector<uint64_t> occupancy;        // non-empty slots
+    std::vector<T> overflow;                // heap of nodes outside the wheel's window
+
+    size_t cursor{ 0 };                     // turn of the first slot, no wheel node is earlier
+    size_t in_wheel{ 0 };
+    size_t count{ 0 };
+
+};
@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <random>
+
+#include "game/dungeon.hpp"
+
+
+/* Compares floor distance map engines -- fibonacci heap Dijkstra, bucket queue
+ * Dijkstra, and the bitboard wavefront -- over a fixed range of seeds. All must
+ * produce identical maps. Pass a larger level size to compare scaling.
+ * Usage: bfs_bench <num seeds = 200> <sources per seed = 64> <width = 80> <height = 21> */
+
+static int floor_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].isFloor();
+}
+static int32_t floor_cell_weight(const DungeonLevel::TerrainMap&, uint16_t, uint16_t)
+{
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t num_seeds = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 200;
+    const uint32_t num_sources = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 64;
+    const uint16_t width = argc > 3 ? static_cast<uint16_t>(atoi(argv[3])) : DUNGEON_X_DIM;
+    const uint16_t height = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : DUNGEON_Y_DIM;
+
+    static PathingContext ctx;
+    static DungeonLevel::TerrainMap map;
+    static DungeonLevel::DungeonCostMap costs;
+    map.resize(width, height);
+    costs.resize(width, height);
+
+    const char* names[] = { "heap", "bucket", "bitwise" };
+    double seconds[3]{ 0., 0., 0. };
+    size_t mismatches = 0;
+
+    for(uint32_t seed = 0; seed < num_seeds; seed++)
+    {
+        map.generateClean(seed);
+        std::mt19937 gen{ seed };
+
+        for(uint32_t i = 0; i < num_sources; i++)
+        {
+            const Vec2u16 from = map.randomRoomFloorPos(gen);
+
+            for(int mode = 0; mode < 3; mode++)
+            {
+                const auto t0 = std::chrono::steady_clock::now();
+                if(mode < 2)
+                {
+                    dungeon_dijkstra_traverse_grid(
+                        ctx, map, from,
+                        floor_should_use,
+                        floor_cell_weight,
+                        true,
+                        mode );
+                }
+                else
+                {
+                    dungeon_bitwise_traverse_floor(ctx, map, from, costs);
+                }
+                const auto t1 = std::chrono::steady_clock::now();
+                seconds[mode] += std::chrono::duration<double>(t1 - t0).count();
+
+                if(mode == 1)
+                {
+                    for(size_t y = 0; y < height; y++)
+                    {
+                        for(size_t x = 0; x < width; x++)
+                        {
+                            costs[y][x] = ctx.buff[y][x].cost;
+                        }
+                    }
+                }
+            }
+
+            dungeon_dijkstra_traverse_grid(ctx, map, from, floor_should_use, floor_cell_weight, true, 1);
+            for(size_t y = 0; y < height; y++)
+            {
+                for(size_t x = 0; x < width; x++)
+                {
+                    mismatches += (costs[y][x] != ctx.buff[y][x].cost);
+                }
+            }
+        }
+    }
+
+    const double n = static_cast<double>(num_seeds) * num_sources;
+    printf("%ux%u cells, %u seeds x %u sources (mismatched cells: %zu)\n",
+        width, height, num_seeds, num_sources, mismatches);
+    printf("%-8s %12s %8s\n", "engine", "us / map", "speedup");
+    for(int mode = 0; mode < 3; mode++)
+    {
+        printf("%-8s %12.2f %8.2f\n", names[mode], seconds[mode] / n * 1e6, seconds[0] / seconds[mode]);
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
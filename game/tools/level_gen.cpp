@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "game/dungeon.hpp"
+
+
+/* Headless batch generator -- builds the levels for a range of seeds on every
+ * core and writes them in the RLG327 save format, for level pools and
+ * regression corpora. Level i is TerrainMap::generate(first + i) with the PC
+ * placed by std::mt19937{ first + i }. Output ending in ".pack" is a single
+ * archive of the records back to back in seed order (each record starts with
+ * its own size), anything else is a directory that gets one file per seed.
+ * The printed hash covers every record in seed order.
+ * Usage: level_gen <first seed> <num levels> <output> <threads = all cores> */
+
+static constexpr uint32_t BATCH_SIZE = 1024;
+
+static bool generate_record(DungeonLevel& level, uint32_t seed, std::vector<uint8_t>& out)
+{
+    level.reset();
+    level.map.generate(seed);
+
+    std::mt19937 gen{ seed };
+    level.pc.state.pos = level.map.randomRoomFloorPos(gen);
+
+    char* buf = nullptr;
+    size_t len = 0;
+    FILE* f = open_memstream(&buf, &len);
+    if(!f) return false;
+
+    const int r = level.saveTerrain(f);
+    fclose(f);
+    out.assign(buf, buf + len);
+    free(buf);
+
+    return !r;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 4)
+    {
+        fprintf(stderr, "Usage: %s <first seed> <num levels> <output dir | archive.pack> <threads>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t first_seed = static_cast<uint32_t>(strtoul(argv[1], nullptr, 10));
+    const uint32_t num_levels = static_cast<uint32_t>(strtoul(argv[2], nullptr, 10));
+    const std::string output = argv[3];
+    const uint32_t num_threads = argc > 4 ?
+        std::max(1, atoi(argv[4])) :
+        std::max(1U, std::thread::hardware_concurrency());
+
+    const bool is_archive = output.size() > 5 && !output.compare(output.size() - 5, 5, ".pack");
+    FILE* archive = nullptr;
+    if(is_archive)
+    {
+        if(!(archive = fopen(output.c_str(), "wb")))
+        {
+            fprintf(stderr, "Failed to open %s\n", output.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        mkdir(output.c_str(), 0755);
+    }
+
+    std::vector<std::unique_ptr<DungeonLevel>> levels(num_threads);
+    std::vector<std::vector<uint8_t>> records(BATCH_SIZE);
+    std::vector<uint8_t> failed(BATCH_SIZE);
+    size_t total_bytes = 0, num_failed = 0;
+    uint64_t hash = 1469598103934665603ULL;
+    double gen_seconds = 0.;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for(uint32_t base = 0; base < num_levels; base += BATCH_SIZE)
+    {
+        const uint32_t n = std::min(BATCH_SIZE, num_levels - base);
+        std::atomic<uint32_t> next{ 0 };
+
+        // GENERATE THE BATCH ON EVERY THREAD
+        const auto g0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for(uint32_t t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back(
+                [&, t]()
+                {
+                    if(!levels[t]) levels[t] = std::make_unique<DungeonLevel>();
+                    for(uint32_t i; (i = next.fetch_add(1)) < n;)
+                    {
+                        failed[i] = !generate_record(*levels[t], first_seed + base + i, records[i]);
+                    }
+                } );
+        }
+        for(std::thread& t : threads) t.join();
+        gen_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - g0).count();
+
+        // WRITE IN SEED ORDER
+        for(uint32_t i = 0; i < n; i++)
+        {
+            if(failed[i])
+            {
+                num_failed++;
+                continue;
+            }
+
+            const std::vector<uint8_t>& r = records[i];
+            for(uint8_t b : r)
+            {
+                hash ^= b;
+                hash *= 1099511628211ULL;
+            }
+            total_bytes += r.size();
+
+            if(is_archive)
+            {
+                fwrite(r.data(), 1, r.size(), archive);
+            }
+            else
+            {
+                const std::string path = output + "/dungeon_" + std::to_string(first_seed + base + i) + ".rlg327";
+                FILE* f = fopen(path.c_str(), "wb");
+                if(!f)
+                {
+                    fprintf(stderr, "Failed to open %s\n", path.c_str());
+                    return EXIT_FAILURE;
+                }
+                fwrite(r.data(), 1, r.size(), f);
+                fclose(f);
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if(archive) fclose(archive);
+
+    printf("%u levels (seeds %u - %u) on %u threads, %zu bytes, hash=%016llx\n",
+        num_levels - static_cast<uint32_t>(num_failed), first_seed, first_seed + num_levels - 1,
+        num_threads, total_bytes, static_cast<unsigned long long>(hash));
+    printf("generation : %10.1f levels/s\n", num_levels / gen_seconds);
+    printf("total      : %10.1f levels/s\n", num_levels / seconds);
+
+    return num_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
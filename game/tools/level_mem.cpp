@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <random>
+
+#include "game/dungeon.hpp"
+
+
+/* Reports the per-cell storage of a generated level, grid by grid, along with
+ * DungeonLevel::memoryUsage() before and after the scratch state is released.
+ * Also times an 8-neighbor open cell scan (terrain + entity grids) like the
+ * one monsters run every move.
+ * Usage: level_mem <W = 1000> <H = 1000> <seed = 0> */
+
+int main(int argc, char** argv)
+{
+    const uint16_t w = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 1000;
+    const uint16_t h = argc > 2 ? static_cast<uint16_t>(atoi(argv[2])) : 1000;
+    const uint32_t seed = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 0;
+
+    DungeonLevel level;
+    level.resize(w, h);
+    level.setSeed(seed);
+    level.generateTerrain();
+
+    std::mt19937 gen{ seed };
+    level.pc.state.pos = level.map.randomRoomFloorPos(gen);
+    level.setEntityAt(level.pc.state.pos, &level.pc);
+    level.updateCosts(true);
+    level.copyVisCells();
+
+    const double cells = static_cast<double>(w) * h;
+    struct
+    {
+        const char* name;
+        size_t bytes;
+    }
+    grids[] =
+    {
+        { "terrain (type, stair, hardness)", level.map.terrain.bytes() },
+        { "floor costs", level.tunnel_costs.bytes() },
+        { "tunneling costs", level.terrain_costs.bytes() },
+        { "floor directions", level.tunnel_dirs.bytes() },
+        { "tunneling directions", level.terrain_dirs.bytes() },
+        { "visibility", level.visibility_map.bytes() },
+        { "entity handles", level.entity_map.bytes() },
+        { "item handles", level.item_map.bytes() },
+    };
+
+    size_t total = 0;
+    printf("%ux%u level, sizeof(Cell) = %zu, sizeof(Entity) = %zu, sizeof(Item) = %zu\n",
+        w, h, sizeof(DungeonLevel::TerrainMap::Cell), sizeof(Entity), sizeof(Item));
+    for(const auto& g : grids)
+    {
+        printf("  %-32s %6.2f bytes/cell\n", g.name, g.bytes / cells);
+        total += g.bytes;
+    }
+    printf("  %-32s %6.2f bytes/cell\n", "total", total / cells);
+
+    printf("memoryUsage() : %10zu bytes\n", level.memoryUsage());
+    level.releaseScratch();
+    printf("  (released)  : %10zu bytes\n", level.memoryUsage());
+
+    // NEIGHBOR SCAN
+    size_t open = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for(int rep = 0; rep < 10; rep++)
+    {
+        for(uint16_t y = 1; y < h - 1; y++)
+        {
+            for(uint16_t x = 1; x < w - 1; x++)
+            {
+                for(const auto& o : DungeonLevel::MOVE_OFFSETS)
+                {
+                    const uint16_t nx = x + o[0], ny = y + o[1];
+                    open += (level.map.terrain[ny][nx].type && !level.entity_map[ny][nx]);
+                }
+            }
+        }
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("neighbor scan : %6.2f ns/cell (%zu open)\n", s / (cells * 10) * 1e9, open);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <random>
+
+#include "game/dungeon.hpp"
+
+
+/* Compares plain Dijkstra against A* for single source/target paths over a
+ * fixed range of seeds. Both modes must agree on every path cost.
+ * Usage: pathing_bench <num seeds = 200> <paths per seed = 64> <width = 80> <height = 21> */
+
+static int corridor_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].hardness != 0xFF;
+}
+static int32_t corridor_cell_weight(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return (int32_t)map.terrain[y][x].hardness;
+}
+static int terrain_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].hardness != 0xFF;
+}
+static int32_t terrain_cell_weight(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].isRock() ? (1 + map.terrain[y][x].hardness / 85) : 1;
+}
+static int floor_should_use(const DungeonLevel::TerrainMap& map, uint16_t x, uint16_t y)
+{
+    return map.terrain[y][x].isFloor();
+}
+static int32_t floor_cell_weight(const DungeonLevel::TerrainMap&, uint16_t, uint16_t)
+{
+    return 1;
+}
+static void discard_path_cell(void*, uint16_t, uint16_t) {}
+
+struct BenchCase
+{
+    const char* name;
+    int(*should_use_cell)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y);
+    int32_t(*cell_weight)(const DungeonLevel::TerrainMap&, uint16_t x, uint16_t y);
+    int use_diag;
+
+    size_t expanded[2]{ 0, 0 };
+    double seconds[2]{ 0., 0. };
+};
+
+int main(int argc, char** argv)
+{
+    const uint32_t num_seeds = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 200;
+    const uint32_t num_paths = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 64;
+    const uint16_t width = argc > 3 ? static_cast<uint16_t>(atoi(argv[3])) : DUNGEON_X_DIM;
+    const uint16_t height = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : DUNGEON_Y_DIM;
+
+    static PathingContext ctx;
+    static DungeonLevel::TerrainMap map;
+    map.resize(width, height);
+
+    BenchCase cases[] =
+    {
+        { "corridor", corridor_should_use, corridor_cell_weight, false },
+        { "terrain", terrain_should_use, terrain_cell_weight, true },
+        { "floor", floor_should_use, floor_cell_weight, true },
+    };
+
+    size_t mismatches = 0;
+    for(uint32_t seed = 0; seed < num_seeds; seed++)
+    {
+        map.generateClean(seed);
+        std::mt19937 gen{ seed };
+
+        uint8_t min_hardness = 0xFF;
+        for(size_t y = 1; y < height - 1u; y++)
+        {
+            for(size_t x = 1; x < width - 1u; x++)
+            {
+                min_hardness = std::min(min_hardness, map.terrain[y][x].hardness);
+            }
+        }
+
+        for(uint32_t i = 0; i < num_paths; i++)
+        {
+            const Vec2u16
+                from = map.randomRoomFloorPos(gen),
+                to = map.randomRoomFloorPos(gen);
+
+            for(BenchCase& c : cases)
+            {
+                const int32_t min_weight = (c.cell_weight == corridor_cell_weight) ? min_hardness : 1;
+                int32_t cost[2];
+
+                for(int mode = 0; mode < 2; mode++)
+                {
+                    ctx.expanded_nodes = 0;
+                    const auto t0 = std::chrono::steady_clock::now();
+                    dungeon_dijkstra_single_path(
+                        ctx, map, nullptr, from, to,
+                        c.should_use_cell,
+                        c.cell_weight,
+                        discard_path_cell,
+                        c.use_diag,
+                        mode ? min_weight : 0 );
+                    const auto t1 = std::chrono::steady_clock::now();
+
+                    c.expanded[mode] += ctx.expanded_nodes;
+                    c.seconds[mode] += std::chrono::duration<double>(t1 - t0).count();
+                    cost[mode] = ctx.buff[to.y][to.x].cost;
+                }
+                mismatches += (cost[0] != cost[1]);
+            }
+        }
+    }
+
+    printf("%ux%u cells, %u seeds x %u paths (cost mismatches: %zu)\n", width, height, num_seeds, num_paths, mismatches);
+    printf("%-10s %14s %14s %10s %12s %12s %8s\n",
+        "case", "dijkstra exp", "astar exp", "ratio", "dijkstra ms", "astar ms", "speedup");
+    for(const BenchCase& c : cases)
+    {
+        printf("%-10s %14zu %14zu %10.3f %12.2f %12.2f %8.2f\n",
+            c.name,
+            c.expanded[0],
+            c.expanded[1],
+            static_cast<double>(c.expanded[1]) / static_cast<double>(c.expanded[0]),
+            c.seconds[0] * 1e3,
+            c.seconds[1] * 1e3,
+            c.seconds[0] / c.seconds[1] );
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "util/perlin.hpp"
+
+
+/* Compares scalar perlin noise against the batched row API (float and double)
+ * over rows with random scales and offsets. Results must be bit-identical.
+ * Usage: perlin_bench <num rows = 4000> <row width = 1000> */
+
+template<typename F>
+static size_t run(
+    const char* name,
+    F(*scalar)(F, F),
+    void(*row)(F*, size_t, size_t, F, F, F),
+    void(*fbm_row)(F*, size_t, size_t, F, F, F, uint32_t, F, F),
+    uint32_t num_rows,
+    size_t width )
+{
+    std::mt19937 gen{ 0 };
+    std::uniform_real_distribution<F> scale_dist{ F(0.01), F(0.5) }, offset_dist{ F(-300), F(300) };
+    std::vector<F> a(width), b(width), c(width);
+    double seconds[2]{ 0., 0. };
+    size_t mismatches = 0;
+
+    for(uint32_t r = 0; r < num_rows; r++)
+    {
+        const F sx = scale_dist(gen), ox = offset_dist(gen), y = offset_dist(gen);
+
+        const auto t0 = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < width; i++)
+        {
+            a[i] = scalar((F)(i + 1) * sx + ox, y);
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        row(b.data(), width, 1, sx, ox, y);
+        const auto t2 = std::chrono::steady_clock::now();
+        fbm_row(c.data(), width, 1, sx, ox, y, 1, F(2), F(0.5));
+
+        seconds[0] += std::chrono::duration<double>(t1 - t0).count();
+        seconds[1] += std::chrono::duration<double>(t2 - t1).count();
+        for(size_t i = 0; i < width; i++)
+        {
+            mismatches += memcmp(&a[i], &b[i], sizeof(F)) || memcmp(&a[i], &c[i], sizeof(F));
+        }
+    }
+
+    const double n = static_cast<double>(num_rows) * width;
+    printf("%-8s scalar %7.2f ns/sample, batched %7.2f ns/sample, speedup %5.2f (mismatches: %zu)\n",
+        name, seconds[0] / n * 1e9, seconds[1] / n * 1e9, seconds[0] / seconds[1], mismatches);
+
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t num_rows = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 4000;
+    const size_t width = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 1000;
+
+    size_t mismatches = 0;
+    mismatches += run<float>("float", perlin2f, perlin2f_row, perlin2f_fbm_row, num_rows, width);
+    mismatches += run<double>("double", perlin2d, perlin2d_row, perlin2d_fbm_row, num_rows, width);
+
+    // grid rows are generated from indices exactly like the scalar loop below
+    std::vector<float> grid(width * 64);
+    perlin2f_grid(grid.data(), width, width, 64, 1, 1, 0.15f, 0.3f, 17.f, 211.f);
+    for(size_t y = 0; y < 64; y++)
+    {
+        for(size_t x = 0; x < width; x++)
+        {
+            const float s = perlin2f((float)(x + 1) * 0.15f + 17.f, (float)(y + 1) * 0.3f + 211.f);
+            mismatches += memcmp(&s, &grid[y * width + x], sizeof(float)) != 0;
+        }
+    }
+    printf("grid mismatches: %zu total\n", mismatches);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}